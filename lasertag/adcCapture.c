@@ -0,0 +1,78 @@
+#include "adcCapture.h"
+#include "spsc.h"
+#include <stddef.h>
+
+// Block capture of ADC samples through a ring of ready blocks.
+
+#define BLOCK_INDEX_MASK (ADC_CAPTURE_BLOCK_COUNT - 1)
+
+// Counts shared between the ISR and the main loop go through spsc.h.
+
+_Static_assert((ADC_CAPTURE_BLOCK_COUNT & BLOCK_INDEX_MASK) == 0,
+               "ADC_CAPTURE_BLOCK_COUNT must be a power of two");
+
+static adcCapture_block_t blocks[ADC_CAPTURE_BLOCK_COUNT];
+static uint32_t publishedCount;     // Blocks filled. Written by the ISR only.
+static uint32_t releasedCount;      // Blocks processed. Written by the main loop only.
+static uint32_t fillIndex;          // Samples in the block being filled. ISR only.
+static uint32_t tickCount;          // Written by the ISR only.
+static uint32_t droppedSampleCount; // Written by the ISR only.
+
+// Empties the ring and zeroes the tick count and the counters.
+void adcCapture_init(void) {
+    SPSC_STORE(publishedCount, 0);
+    SPSC_STORE(releasedCount, 0);
+    fillIndex = 0;
+    SPSC_STORE(tickCount, 0);
+    SPSC_STORE(droppedSampleCount, 0);
+}
+
+// Adds one ADC sample to the block being filled. Called from the ISR at
+// 100 kHz; also advances the tick count.
+void adcCapture_tick(buffer_data_t sample) {
+    uint32_t published = publishedCount; // Only the ISR writes it.
+    // A new block can only start once the main loop has released the block
+    // that used its slot last time around.
+    if (fillIndex == 0 &&
+        published - SPSC_LOAD(releasedCount) == ADC_CAPTURE_BLOCK_COUNT) {
+        SPSC_STORE(droppedSampleCount, droppedSampleCount + 1);
+    } else {
+        adcCapture_block_t *block = &blocks[published & BLOCK_INDEX_MASK];
+        if (fillIndex == 0)
+            block->firstTick = tickCount;
+        block->samples[fillIndex++] = sample;
+        if (fillIndex == ADC_CAPTURE_BLOCK_SIZE) {
+            fillIndex = 0;
+            SPSC_STORE(publishedCount, published + 1);
+        }
+    }
+    SPSC_STORE(tickCount, tickCount + 1);
+}
+
+// Returns the oldest ready block, or NULL if none is ready. The block stays
+// valid until adcCapture_releaseBlock(). Main loop only.
+const adcCapture_block_t *adcCapture_getReadyBlock(void) {
+    if (SPSC_LOAD(publishedCount) == releasedCount)
+        return NULL;
+    return &blocks[releasedCount & BLOCK_INDEX_MASK];
+}
+
+// Hands the block returned by adcCapture_getReadyBlock() back to the ISR.
+void adcCapture_releaseBlock(void) {
+    SPSC_STORE(releasedCount, releasedCount + 1);
+}
+
+// Returns the number of ready blocks.
+uint32_t adcCapture_readyBlockCount(void) {
+    return SPSC_LOAD(publishedCount) - releasedCount;
+}
+
+// Returns the number of adcCapture_tick() calls since adcCapture_init().
+uint32_t adcCapture_getTickCount(void) {
+    return SPSC_LOAD(tickCount);
+}
+
+// Returns the number of samples dropped because no block was free.
+uint32_t adcCapture_getDroppedSampleCount(void) {
+    return SPSC_LOAD(droppedSampleCount);
+}
@@ -0,0 +1,59 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ADCCAPTURE_H_
+#define ADCCAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "buffer.h"
+
+// Block capture of ADC samples, an alternative to buffer_pushover() in the ISR.
+// The ISR writes each sample into the block it is filling. When the block is
+// full it stamps it and publishes it to a ring of ready blocks; the main loop
+// takes ready blocks in order, processes them in place and releases them.
+// Like buffer.c this is a single-producer/single-consumer ring: the ISR owns
+// the fill count and the main loop owns the release count. If every block is
+// waiting for the main loop, the ISR drops the samples of the block it is
+// filling and counts them.
+
+#define ADC_CAPTURE_BLOCK_SIZE 100 // Samples per block (1 ms at 100 kHz).
+#define ADC_CAPTURE_BLOCK_COUNT 16 // Blocks in the ring, a power of two.
+
+typedef struct {
+  buffer_data_t samples[ADC_CAPTURE_BLOCK_SIZE];
+  // adcCapture_getTickCount() when the first sample was taken.
+  uint32_t firstTick;
+} adcCapture_block_t;
+
+// Empties the ring and zeroes the tick count and the counters.
+void adcCapture_init(void);
+
+// Adds one ADC sample to the block being filled. Called from the ISR at
+// 100 kHz; also advances the tick count.
+void adcCapture_tick(buffer_data_t sample);
+
+// Returns the oldest ready block, or NULL if none is ready. The block stays
+// valid until adcCapture_releaseBlock(). Main loop only.
+const adcCapture_block_t *adcCapture_getReadyBlock(void);
+
+// Hands the block returned by adcCapture_getReadyBlock() back to the ISR.
+void adcCapture_releaseBlock(void);
+
+// Returns the number of ready blocks.
+uint32_t adcCapture_readyBlockCount(void);
+
+// Returns the number of adcCapture_tick() calls since adcCapture_init().
+uint32_t adcCapture_getTickCount(void);
+
+// Returns the number of samples dropped because no block was free.
+uint32_t adcCapture_getDroppedSampleCount(void);
+
+#endif /* ADCCAPTURE_H_ */
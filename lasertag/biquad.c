@@ -0,0 +1,152 @@
+#include "biquad.h"
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Single-precision cascade of second-order IIR sections (biquads).
+
+/******************************************************************************
+***** Definitions
+******************************************************************************/
+
+#define B0 0
+#define B1 1
+#define B2 2
+#define A1 3
+#define A2 4
+
+// GCC does not use NEON for generic float vectors (NEON is not IEEE
+// compliant), so the A9 build uses intrinsics and the host uses vector
+// extensions.
+#if !defined(__ARM_NEON) && defined(__GNUC__)
+#define BIQUAD_USE_VECTOR_EXTENSIONS
+typedef float biquad_v4sf_t __attribute__((vector_size(16)));
+#endif
+
+/******************************************************************************
+***** Single Cascade
+******************************************************************************/
+
+// Attaches the section table and zeroes the state. sectionCount must not
+// exceed BIQUAD_MAX_SECTION_COUNT.
+void biquad_init(biquad_cascade_t *c, const biquad_section_t sections[],
+                 uint32_t sectionCount) {
+    c->sections = sections;
+    c->sectionCount = sectionCount;
+    biquad_reset(c);
+}
+
+// Zeroes the state of every section.
+void biquad_reset(biquad_cascade_t *c) {
+    for (uint32_t i = 0; i < c->sectionCount; i++) {
+        c->state[i][0] = 0.0f;
+        c->state[i][1] = 0.0f;
+    }
+}
+
+// Runs one input through all sections and returns the output of the last.
+float biquad_filter(biquad_cascade_t *c, float x) {
+    for (uint32_t i = 0; i < c->sectionCount; i++) {
+        const biquad_section_t *s = &c->sections[i];
+        float *state = c->state[i];
+        float y = s->b0 * x + state[0];
+        state[0] = s->b1 * x - s->a1 * y + state[1];
+        state[1] = s->b2 * x - s->a2 * y;
+        x = y; // Output of this section feeds the next one.
+    }
+    return x;
+}
+
+/******************************************************************************
+***** Lane-Interleaved Bank
+******************************************************************************/
+
+// Interleaves laneCount cascades of sectionCount sections each and zeroes
+// the state. sections[] is lane-major: lane i starts at sections[i *
+// sectionCount]. laneCount must not exceed BIQUAD_BANK_MAX_LANE_COUNT.
+void biquad_bankInit(biquad_bank_t *bank, const biquad_section_t sections[],
+                     uint32_t laneCount, uint32_t sectionCount) {
+    memset(bank->coefficients, 0, sizeof(bank->coefficients));
+    bank->laneCount = laneCount;
+    bank->sectionCount = sectionCount;
+    for (uint32_t lane = 0; lane < laneCount; lane++) {
+        for (uint32_t i = 0; i < sectionCount; i++) {
+            const biquad_section_t *s = &sections[lane * sectionCount + i];
+            bank->coefficients[i][B0][lane] = s->b0;
+            bank->coefficients[i][B1][lane] = s->b1;
+            bank->coefficients[i][B2][lane] = s->b2;
+            bank->coefficients[i][A1][lane] = s->a1;
+            bank->coefficients[i][A2][lane] = s->a2;
+        }
+    }
+    biquad_bankReset(bank);
+}
+
+// Zeroes the state of every lane.
+void biquad_bankReset(biquad_bank_t *bank) {
+    memset(bank->state, 0, sizeof(bank->state));
+}
+
+// Runs x through every lane and writes laneCount outputs.
+void biquad_bankFilter(biquad_bank_t *bank, float x, float outputs[]) {
+    float laneOutputs[BIQUAD_BANK_MAX_LANE_COUNT] __attribute__((aligned(16)));
+    for (uint32_t lane = 0; lane < bank->laneCount; lane += BIQUAD_LANES_PER_VECTOR) {
+#if defined(__ARM_NEON)
+        float32x4_t in = vdupq_n_f32(x);
+        for (uint32_t i = 0; i < bank->sectionCount; i++) {
+            float (*c)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->coefficients[i];
+            float (*state)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->state[i];
+            float32x4_t s0 = vld1q_f32(&state[0][lane]);
+            float32x4_t s1 = vld1q_f32(&state[1][lane]);
+            float32x4_t y = vmlaq_f32(s0, vld1q_f32(&c[B0][lane]), in);
+            // Same operation order as biquad_bankFilterLane().
+            s0 = vaddq_f32(vmlsq_f32(vmulq_f32(vld1q_f32(&c[B1][lane]), in),
+                                     vld1q_f32(&c[A1][lane]), y),
+                           s1);
+            s1 = vmlsq_f32(vmulq_f32(vld1q_f32(&c[B2][lane]), in),
+                           vld1q_f32(&c[A2][lane]), y);
+            vst1q_f32(&state[0][lane], s0);
+            vst1q_f32(&state[1][lane], s1);
+            in = y; // Output of this section feeds the next one.
+        }
+        vst1q_f32(&laneOutputs[lane], in);
+#elif defined(BIQUAD_USE_VECTOR_EXTENSIONS)
+        biquad_v4sf_t in = {x, x, x, x};
+        for (uint32_t i = 0; i < bank->sectionCount; i++) {
+            float (*c)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->coefficients[i];
+            float (*state)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->state[i];
+            biquad_v4sf_t *s0 = (biquad_v4sf_t *)&state[0][lane];
+            biquad_v4sf_t *s1 = (biquad_v4sf_t *)&state[1][lane];
+            biquad_v4sf_t y = *(biquad_v4sf_t *)&c[B0][lane] * in + *s0;
+            *s0 = *(biquad_v4sf_t *)&c[B1][lane] * in -
+                  *(biquad_v4sf_t *)&c[A1][lane] * y + *s1;
+            *s1 = *(biquad_v4sf_t *)&c[B2][lane] * in -
+                  *(biquad_v4sf_t *)&c[A2][lane] * y;
+            in = y; // Output of this section feeds the next one.
+        }
+        *(biquad_v4sf_t *)&laneOutputs[lane] = in;
+#else
+        for (uint32_t k = lane; k < lane + BIQUAD_LANES_PER_VECTOR; k++)
+            laneOutputs[k] = biquad_bankFilterLane(bank, k, x);
+#endif
+    }
+    for (uint32_t lane = 0; lane < bank->laneCount; lane++)
+        outputs[lane] = laneOutputs[lane];
+}
+
+// Runs x through a single lane and returns its output. Gives the same result
+// as that lane of biquad_bankFilter(), apart from denormals that NEON flushes
+// to zero.
+float biquad_bankFilterLane(biquad_bank_t *bank, uint32_t lane, float x) {
+    for (uint32_t i = 0; i < bank->sectionCount; i++) {
+        float (*c)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->coefficients[i];
+        float (*state)[BIQUAD_BANK_MAX_LANE_COUNT] = bank->state[i];
+        float y = c[B0][lane] * x + state[0][lane];
+        state[0][lane] = c[B1][lane] * x - c[A1][lane] * y + state[1][lane];
+        state[1][lane] = c[B2][lane] * x - c[A2][lane] * y;
+        x = y; // Output of this section feeds the next one.
+    }
+    return x;
+}
@@ -0,0 +1,86 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef BIQUAD_H_
+#define BIQUAD_H_
+
+#include <stdint.h>
+
+// Single-precision cascade of second-order IIR sections (biquads).
+// A high-order direct-form IIR filter needs double precision because its
+// poles move a long way when the coefficients are rounded. Split into
+// biquads, each pole pair depends on two coefficients only, so float is
+// enough. Sections run in transposed direct form II: two state values per
+// section and five multiplies per section.
+// Section tables are generated offline with tools/iir2sos.py --format float.
+
+#define BIQUAD_MAX_SECTION_COUNT 8
+// Lanes are processed four at a time (one NEON quad register of floats).
+#define BIQUAD_LANES_PER_VECTOR 4
+#define BIQUAD_BANK_MAX_LANE_COUNT 12
+
+// One section, y = (b0 + b1 z^-1 + b2 z^-2) / (1 + a1 z^-1 + a2 z^-2) x.
+typedef struct {
+  float b0, b1, b2, a1, a2;
+} biquad_section_t;
+
+typedef struct {
+  // Points at a constant section table, usually in filter.c.
+  const biquad_section_t *sections;
+  // Transposed direct form II state, two values per section.
+  float state[BIQUAD_MAX_SECTION_COUNT][2];
+  // Number of sections in use.
+  uint32_t sectionCount;
+} biquad_cascade_t;
+
+// Attaches the section table and zeroes the state. sectionCount must not
+// exceed BIQUAD_MAX_SECTION_COUNT.
+void biquad_init(biquad_cascade_t *c, const biquad_section_t sections[],
+                 uint32_t sectionCount);
+
+// Zeroes the state of every section.
+void biquad_reset(biquad_cascade_t *c);
+
+// Runs one input through all sections and returns the output of the last.
+float biquad_filter(biquad_cascade_t *c, float x);
+
+// A bank of cascades that all filter the same input, one cascade per lane.
+// Coefficients and state are stored lane-interleaved (struct of arrays), so
+// one vector instruction advances the same section of four cascades. Unused
+// lanes up to the next multiple of BIQUAD_LANES_PER_VECTOR have zero
+// coefficients and always output zero.
+typedef struct {
+  // coefficients[section][k][lane], k in {b0, b1, b2, a1, a2} order.
+  float coefficients[BIQUAD_MAX_SECTION_COUNT][5][BIQUAD_BANK_MAX_LANE_COUNT]
+      __attribute__((aligned(16)));
+  // state[section][k][lane], transposed direct form II.
+  float state[BIQUAD_MAX_SECTION_COUNT][2][BIQUAD_BANK_MAX_LANE_COUNT]
+      __attribute__((aligned(16)));
+  uint32_t sectionCount;
+  uint32_t laneCount;
+} biquad_bank_t;
+
+// Interleaves laneCount cascades of sectionCount sections each and zeroes
+// the state. sections[] is lane-major: lane i starts at sections[i *
+// sectionCount]. laneCount must not exceed BIQUAD_BANK_MAX_LANE_COUNT.
+void biquad_bankInit(biquad_bank_t *bank, const biquad_section_t sections[],
+                     uint32_t laneCount, uint32_t sectionCount);
+
+// Zeroes the state of every lane.
+void biquad_bankReset(biquad_bank_t *bank);
+
+// Runs x through every lane and writes laneCount outputs.
+void biquad_bankFilter(biquad_bank_t *bank, float x, float outputs[]);
+
+// Runs x through a single lane and returns its output. Gives the same result
+// as that lane of biquad_bankFilter(), apart from denormals that NEON flushes
+// to zero.
+float biquad_bankFilterLane(biquad_bank_t *bank, uint32_t lane, float x);
+
+#endif /* BIQUAD_H_ */
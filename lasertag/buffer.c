@@ -1,9 +1,13 @@
 #include "buffer.h"
+#include "spsc.h"
 #include <stdint.h>
+#include <string.h>
  
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by the detector.
 // The function of the buffer is similar to a queue or FIFO.
+// Single producer (the ADC ISR), single consumer (the main loop): each index
+// is written by one side only, so no interrupt masking is needed.
  
 // Uncomment for debug prints
 // #define DEBUG
@@ -16,58 +20,188 @@
 #define DPRINTF(...)
 #endif
  
-#define BUFFER_SIZE 32768
+#define BUFFER_SIZE BUFFER_CAPACITY // Must be a power of two.
+#define BUFFER_INDEX_MASK (BUFFER_SIZE - 1)
+#define BYTES_PER_SAMPLE_PAIR 3 // BUFFER_PACK_12_BIT: two 12-bit samples.
  
+// The write index is published after the value it covers is stored, and read
+// before the values it covers are loaded (see spsc.h). The read index is
+// shared the same way; the producer only reads it for the statistics.
+ 
+_Static_assert(BUFFER_SIZE >= 2 && (BUFFER_SIZE & BUFFER_INDEX_MASK) == 0,
+               "BUFFER_CAPACITY must be a power of two");
+ 
+// The indices count every value ever pushed or removed and wrap at 2^32,
+// which is a multiple of BUFFER_SIZE, so index & BUFFER_INDEX_MASK is the slot.
 typedef struct {
-    uint32_t indexIn; // Points to the next open slot.
-    uint32_t indexOut; // Points to the next element to be removed.
-    uint32_t elementCount; // Number of elements in the buffer.
+    uint32_t writeIndex; // Values pushed. Written by the producer only.
+    uint32_t readIndex; // Values removed or dropped. Written by the consumer only.
+#ifdef BUFFER_PACK_12_BIT
+    // Pair p holds samples 2p and 2p + 1: the low 8 bits of the even sample,
+    // then its high 4 bits and the low 4 bits of the odd sample, then the high
+    // 8 bits of the odd sample.
+    uint8_t data[BUFFER_SIZE / 2 * BYTES_PER_SAMPLE_PAIR];
+#else
     buffer_data_t data[BUFFER_SIZE]; // Values are stored here.
+#endif
 } buffer_t;
  
-volatile static buffer_t buf;
+static buffer_t buf;
  
+// The consumer writes maxOldestValueAge and oldestValueAge (in
+// buffer_getStats()); the producer writes the rest.
+static buffer_stats_t stats;
+ 
+// Returns the index of the oldest value that has not been overwritten, given
+// a snapshot of the write index. The producer overwrites the oldest values
+// when the buffer is full without touching readIndex, so the consumer skips
+// them here.
+static uint32_t oldestIndex(uint32_t writeIndex)
+{
+    if (writeIndex - buf.readIndex > BUFFER_SIZE)
+        return writeIndex - BUFFER_SIZE;
+    return buf.readIndex;
+}
+ 
+// Stores value in a slot. Producer side.
+static void storeValue(uint32_t slot, buffer_data_t value)
+{
+#ifdef BUFFER_PACK_12_BIT
+    uint8_t *pair = &buf.data[slot / 2 * BYTES_PER_SAMPLE_PAIR];
+    value &= BUFFER_VALUE_MASK;
+    if (slot % 2 == 0) {
+        pair[0] = value;
+        pair[1] = (pair[1] & 0xF0) | (value >> 8);
+    } else {
+        pair[1] = (pair[1] & 0x0F) | ((value & 0x0F) << 4);
+        pair[2] = value >> 4;
+    }
+#else
+    buf.data[slot] = value;
+#endif
+}
+ 
+// Copies count values starting at slot into dst[]. The span must not wrap.
+static void copyValues(buffer_data_t dst[], uint32_t slot, uint32_t count)
+{
+#ifdef BUFFER_PACK_12_BIT
+    for (uint32_t i = 0; i < count; i++, slot++) {
+        const uint8_t *pair = &buf.data[slot / 2 * BYTES_PER_SAMPLE_PAIR];
+        dst[i] = (slot % 2 == 0) ? pair[0] | ((pair[1] & 0x0F) << 8)
+                                 : (pair[1] >> 4) | (pair[2] << 4);
+    }
+#else
+    memcpy(dst, &buf.data[slot], count * sizeof(buffer_data_t));
+#endif
+}
  
 // Initialize the buffer to empty.
 void buffer_init(void)
 {
-    buf.indexIn = 0;
-    buf.indexOut = 0;
-    buf.elementCount = 0;
-    for (uint16_t i = 0; i < BUFFER_SIZE; i++)
-        buf.data[i] = 0;
+    SPSC_STORE(buf.readIndex, 0);
+    SPSC_STORE(buf.writeIndex, 0);
+    memset(buf.data, 0, sizeof(buf.data));
+    memset(&stats, 0, sizeof(stats));
 }
  
 // Add a value to the buffer. Overwrite the oldest value if full.
+// Producer side (ISR).
 void buffer_pushover(buffer_data_t value)
 {
-    buf.data[buf.indexIn] = value;
-    buf.indexIn = (buf.indexIn + 1) % BUFFER_SIZE;
-    if (buf.elementCount < BUFFER_SIZE)
-        buf.elementCount++;
-    else
-        buf.indexOut = (buf.indexOut + 1) % BUFFER_SIZE;
+    uint32_t writeIndex = buf.writeIndex; // Only this side writes it.
+    storeValue(writeIndex & BUFFER_INDEX_MASK, value);
+    SPSC_STORE(buf.writeIndex, writeIndex + 1);
+    // readIndex lags behind values that were already overwritten, so the
+    // count can exceed BUFFER_SIZE; each push past full overwrites one more.
+    uint32_t elements = writeIndex - SPSC_LOAD(buf.readIndex);
+    if (elements >= BUFFER_SIZE) {
+        stats.overwrittenCount++;
+        elements = BUFFER_SIZE;
+    } else {
+        elements++;
+    }
+    if (elements > stats.highWaterMark)
+        stats.highWaterMark = elements;
+    stats.occupancyHistogram[(elements - 1) * BUFFER_STATS_HISTOGRAM_BIN_COUNT /
+                             BUFFER_SIZE]++;
+    stats.pushCount++;
 }
  
 // Remove a value from the buffer. Return zero if empty.
+// Consumer side (main loop).
 buffer_data_t buffer_pop(void)
 {
-    if (!buf.elementCount)
-        return 0;
-    buffer_data_t value = buf.data[buf.indexOut];
-    buf.indexOut = (buf.indexOut + 1) % BUFFER_SIZE;
-    buf.elementCount--;
-    return value;
+    buffer_data_t value;
+    return buffer_popMany(&value, 1) ? value : 0;
+}
+ 
+// Remove up to max of the oldest values into dst[], oldest first, and return
+// the number removed. Copies at most two contiguous spans of the ring; values
+// the producer overwrote during the copy are dropped. Consumer side.
+uint32_t buffer_popMany(buffer_data_t dst[], uint32_t max)
+{
+    uint32_t writeIndex = SPSC_LOAD(buf.writeIndex);
+    uint32_t readIndex = oldestIndex(writeIndex);
+    uint32_t count = writeIndex - readIndex;
+    if (count > stats.maxOldestValueAge)
+        stats.maxOldestValueAge = count;
+    if (count > max)
+        count = max;
+    uint32_t slot = readIndex & BUFFER_INDEX_MASK;
+    uint32_t firstSpan = (count < BUFFER_SIZE - slot) ? count : BUFFER_SIZE - slot;
+    copyValues(dst, slot, firstSpan);
+    copyValues(&dst[firstSpan], 0, count - firstSpan);
+    // If the ISR lapped the copy, the front of dst[] may hold newer values.
+    writeIndex = SPSC_LOAD(buf.writeIndex);
+    uint32_t dropped = 0;
+    if (writeIndex - readIndex > BUFFER_SIZE) {
+        dropped = writeIndex - BUFFER_SIZE - readIndex;
+        if (dropped > count)
+            dropped = count;
+        memmove(dst, &dst[dropped], (count - dropped) * sizeof(buffer_data_t));
+        DPRINTF("buffer_popMany: %d values overwritten during the copy\n", dropped);
+    }
+    SPSC_STORE(buf.readIndex, readIndex + count);
+    return count - dropped;
+}
+ 
+// Remove exactly blockSize of the oldest values into dst[] and return true if
+// the buffer holds at least that many; otherwise remove nothing and return
+// false. Consumer side.
+bool buffer_popBlock(buffer_data_t dst[], uint32_t blockSize)
+{
+    if (buffer_elements() < blockSize)
+        return false;
+    // Only the consumer removes values, so the block is still there; the
+    // count only falls short if the producer lapped the copy.
+    return buffer_popMany(dst, blockSize) == blockSize;
 }
  
 // Return the number of elements in the buffer.
 uint32_t buffer_elements(void)
 {
-    return buf.elementCount;
+    uint32_t writeIndex = SPSC_LOAD(buf.writeIndex);
+    return writeIndex - oldestIndex(writeIndex);
+}
+ 
+// Return the number of values removed or dropped since buffer_init(). The ISR
+// pushes one value per tick, so after a pop that returned n values the first
+// of them was pushed on tick buffer_getReadCount() - n. Consumer side.
+uint32_t buffer_getReadCount(void)
+{
+    return buf.readIndex;
 }
  
 // Return the capacity of the buffer in elements.
 uint32_t buffer_size(void)
 {
     return BUFFER_SIZE;
+}
+ 
+// Return a copy of the health counters. The producer keeps pushing while they
+// are copied, so they can be a few values apart. Consumer side.
+buffer_stats_t buffer_getStats(void)
+{
+    stats.oldestValueAge = buffer_elements();
+    return stats;
 }
\ No newline at end of file
@@ -10,28 +10,92 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef BUFFER_H_
 #define BUFFER_H_
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // This implements a dedicated circular buffer for storing values
 // from the ADC until they are read and processed by the detector.
 // The function of the buffer is similar to a queue or FIFO.
+// It is a single-producer/single-consumer ring: the ADC timer ISR is the only
+// caller of buffer_pushover() and the main loop is the only caller of the pop
+// functions. The producer owns the write index and the consumer owns the read
+// index, so neither side masks interrupts. The capacity is a power of two and
+// the indices run freely; the element count is their difference.
+// The XADC delivers 12-bit samples, so values are stored in 16 bits, or
+// packed two per three bytes with BUFFER_PACK_12_BIT.
+
+// Capacity in samples, a power of two. Override with -DBUFFER_CAPACITY=...
+#ifndef BUFFER_CAPACITY
+#define BUFFER_CAPACITY 32768
+#endif
+
+// Uncomment to store two 12-bit samples in three bytes (48 KB instead of
+// 64 KB at the default capacity). Values are masked to 12 bits on push and
+// the pop functions unpack them.
+// #define BUFFER_PACK_12_BIT
+
+#ifdef BUFFER_PACK_12_BIT
+#define BUFFER_VALUE_MASK 0x0FFF
+#else
+#define BUFFER_VALUE_MASK 0xFFFF
+#endif
 
 // Type of elements in the buffer.
-typedef uint32_t buffer_data_t;
+typedef uint16_t buffer_data_t;
+
+#define BUFFER_STATS_HISTOGRAM_BIN_COUNT 8
+
+// Health counters, kept since buffer_init(). The ISR pushes one value per ADC
+// tick, so ages in values are also ages in ticks (10 us at 100 kHz).
+typedef struct {
+  uint32_t pushCount;        // Values pushed.
+  uint32_t overwrittenCount; // Values overwritten before they were popped.
+  uint32_t highWaterMark;    // Most elements ever held.
+  // Bin i counts the pushes that left between i and i + 1 eighths of the
+  // capacity in the buffer (the upper bound included). Pushes into a full
+  // buffer land in the last bin.
+  uint32_t occupancyHistogram[BUFFER_STATS_HISTOGRAM_BIN_COUNT];
+  // Age of the oldest unprocessed value when the stats were read.
+  uint32_t oldestValueAge;
+  // Largest age of the oldest value found by a pop, i.e. the worst latency
+  // between a sample and the detector reaching it.
+  uint32_t maxOldestValueAge;
+} buffer_stats_t;
 
 // Initialize the buffer to empty.
 void buffer_init(void);
 
 // Add a value to the buffer. Overwrite the oldest value if full.
+// Producer side (ISR).
 void buffer_pushover(buffer_data_t value);
 
 // Remove a value from the buffer. Return zero if empty.
+// Consumer side (main loop).
 buffer_data_t buffer_pop(void);
 
+// Remove up to max of the oldest values into dst[], oldest first, and return
+// the number removed. Copies at most two contiguous spans of the ring; values
+// the producer overwrote during the copy are dropped. Consumer side.
+uint32_t buffer_popMany(buffer_data_t dst[], uint32_t max);
+
+// Remove exactly blockSize of the oldest values into dst[] and return true if
+// the buffer holds at least that many; otherwise remove nothing and return
+// false. Consumer side.
+bool buffer_popBlock(buffer_data_t dst[], uint32_t blockSize);
+
 // Return the number of elements in the buffer.
 uint32_t buffer_elements(void);
 
+// Return the number of values removed or dropped since buffer_init(). The ISR
+// pushes one value per tick, so after a pop that returned n values the first
+// of them was pushed on tick buffer_getReadCount() - n. Consumer side.
+uint32_t buffer_getReadCount(void);
+
 // Return the capacity of the buffer in elements.
 uint32_t buffer_size(void);
 
+// Return a copy of the health counters. The producer keeps pushing while they
+// are copied, so they can be a few values apart. Consumer side.
+buffer_stats_t buffer_getStats(void);
+
 #endif /* BUFFER_H_ */
@@ -1,7 +1,13 @@
 #include "detector.h"
 #include "filter.h"
 #include "buffer.h"
-#include "interrupts.h"
+#include "adcCapture.h"
+#include "hitLedTimer.h"
+#include "lockoutTimer.h"
+#include "powerRank.h"
+#include "spsc.h"
+#include <stdio.h>
+#include <stdlib.h>
 
 // Uncomment for debug prints
 // #define DEBUG
@@ -15,76 +21,237 @@
 #endif
 
 #define FILTER_NUMBER 10
-#define DECIMATION_VAL 10
+#define DETECTOR_BLOCK_SIZE ADC_CAPTURE_BLOCK_SIZE // ADC samples handed to filter_processBlock().
+#define DETECTOR_TEST_DRIFT_OUTPUT_COUNT 1000 // Outputs of drifting powers in detector_runTest().
+#define DETECTOR_HIT_BIT(frequency) ((detector_hitMask_t)1 << (frequency))
+#define HIT_EVENT_INDEX_MASK (DETECTOR_HIT_EVENT_CAPACITY - 1)
+#define DETECTOR_TEST_DROPPED_EVENT_COUNT 3 // Events past a full ring in detector_runTest().
+
+_Static_assert((DETECTOR_HIT_EVENT_CAPACITY & HIT_EVENT_INDEX_MASK) == 0,
+               "DETECTOR_HIT_EVENT_CAPACITY must be a power of two");
+
+// Power estimator behind the detector, see filter_powerMode_t in filter.h.
+// Build with -DDETECTOR_POWER_MODE=FILTER_POWER_GOERTZEL to swap the IIR bank
+// for the Goertzel bins.
+#ifndef DETECTOR_POWER_MODE
+#define DETECTOR_POWER_MODE FILTER_POWER_SLIDING_WINDOW
+#endif
+// The powers are ranked with the constant-time sorting network in
+// powerRank.c. Build with -DDETECTOR_INCREMENTAL_RANKING to re-sort from the
+// order of the previous output instead (powerRank_update()).
+
+// A hit needs the largest power to exceed the median power times the fudge
+// factor picked with detector_setFudgeFactorIndex(). detector_setFudgeFactor()
+// changes the values at run time.
+static double fudgeFactors[] = {400.0, 1000.0, 1500.0, 2000.0, 5000.0};
+#define FUDGE_FACTOR_COUNT (sizeof(fudgeFactors) / sizeof(fudgeFactors[0]))
 
 volatile static detector_hitCount_t hitArray[FILTER_NUMBER];
 volatile static bool hitDetectedFlag;
-volatile static bool freqArray[FILTER_NUMBER];
-volatile static bool fudgeFactorIndex;
+volatile static uint16_t lastHitFrequency;
+volatile static detector_hitMask_t ignoredFrequencyMask;
+volatile static bool ignoreAllHitsFlag; // Invincibility, see detector_ignoreAllHits().
+volatile static detector_hitMask_t hitMask; // Newest decimated output.
+volatile static detector_hitMode_t hitMode;
+volatile static uint32_t fudgeFactorIndex;
+volatile static double fudgeFactor; // fudgeFactors[fudgeFactorIndex].
+static uint32_t invocationCount; // detector() and detector_runBlocks() calls.
+// The powers of the newest decimated output, ranked once per output by
+// updatePowerView(), so the hit check reads the argmax and the median without
+// rescanning.
+static powerRank_t powerRank;
+// Ring of hit events, see detector.h. The counts run freely and wrap at 2^32,
+// a multiple of DETECTOR_HIT_EVENT_CAPACITY.
+static detector_hitEvent_t hitEvents[DETECTOR_HIT_EVENT_CAPACITY];
+static uint32_t publishedHitEventCount; // Written by the producer only.
+static uint32_t takenHitEventCount;     // Written by the consumer only.
+static uint32_t droppedHitEventCount;   // Written by the producer only.
+static detector_blockStats_t blockStats; // detector_runBlocks() timing.
+
+// Empties the hit event ring and zeroes the dropped count.
+static void resetHitEvents(void) {
+    SPSC_STORE(publishedHitEventCount, 0);
+    SPSC_STORE(takenHitEventCount, 0);
+    SPSC_STORE(droppedHitEventCount, 0);
+}
 
 // Initialize the detector module.
 // By default, all frequencies are considered for hits.
 // Assumes the filter module is initialized previously.
 void detector_init(void) {
-    filter_init();
+    filter_initWithPowerMode(DETECTOR_POWER_MODE);
     for (uint8_t i = 0; i < FILTER_NUMBER; i++)
         hitArray[i] = 0;
     hitDetectedFlag = false;
-    fudgeFactorIndex = 0;
+    lastHitFrequency = 0;
+    ignoredFrequencyMask = 0;
+    ignoreAllHitsFlag = false;
+    hitMask = 0;
+    hitMode = DETECTOR_HIT_MODE_SINGLE;
+    detector_setFudgeFactorIndex(0);
+    invocationCount = 0;
+    powerRank_init(&powerRank);
+    resetHitEvents();
+    blockStats = (detector_blockStats_t){0, 0, 0, 0};
 }
 
 // freqArray is indexed by frequency number. If an element is set to true,
 // the frequency will be ignored. Multiple frequencies can be ignored.
 // Your shot frequency (based on the switches) is a good choice to ignore.
 void detector_setIgnoredFrequencies(bool freqArray[]) {
+    detector_hitMask_t mask = 0;
     for (uint8_t i = 0; i < FILTER_NUMBER; i++)
         if (freqArray[i])
-            hitArray[i] = 0;
-    
+            mask |= DETECTOR_HIT_BIT(i);
+    ignoredFrequencyMask = mask;
+}
+
+// Picks how many frequencies one decimated output can report, see
+// detector_hitMode_t.
+void detector_setHitMode(detector_hitMode_t mode) {
+    hitMode = mode;
+}
+
+// Ranks the powers of the newest decimated output into powerRank.
+static void updatePowerView(const double powerValues[]) {
+#ifdef DETECTOR_INCREMENTAL_RANKING
+    powerRank_update(powerValues, &powerRank);
+#else
+    powerRank_sort(powerValues, &powerRank);
+#endif
+}
+
+// Returns the hit threshold of the powers in powerRank: the median power
+// times the fudge factor.
+static double hitThreshold(void) {
+    return powerRank_medianPower(&powerRank) * fudgeFactor;
+}
+
+// Returns the mask of the frequencies in powerRank whose power exceeds
+// hitThreshold(), without the ignored ones. Walks the sorted powers down from
+// the largest and stops at the first one below the threshold;
+// DETECTOR_HIT_MODE_SINGLE stops after the largest. Sets
+// *strongestFrequency to the hit frequency with the largest power.
+static detector_hitMask_t findHits(uint16_t *strongestFrequency) {
+    double threshold = hitThreshold();
+    detector_hitMask_t mask = 0;
+    for (uint16_t i = FILTER_NUMBER; i-- > 0;) {
+        uint16_t frequency = powerRank.frequency[i];
+        if (powerRank.power[i] <= threshold)
+            break;
+        if (!(ignoredFrequencyMask & DETECTOR_HIT_BIT(frequency))) {
+            if (mask == 0)
+                *strongestFrequency = frequency;
+            mask |= DETECTOR_HIT_BIT(frequency);
+        }
+        if (hitMode == DETECTOR_HIT_MODE_SINGLE)
+            break;
+    }
+    return mask;
+}
+
+// Adds an event to the hit event ring, or drops and counts it if the ring is
+// full. Producer side.
+static void recordHitEvent(detector_hitEvent_t event) {
+    uint32_t published = publishedHitEventCount; // Only the producer writes it.
+    if (published - SPSC_LOAD(takenHitEventCount) == DETECTOR_HIT_EVENT_CAPACITY) {
+        SPSC_STORE(droppedHitEventCount, droppedHitEventCount + 1);
+        return;
+    }
+    hitEvents[published & HIT_EVENT_INDEX_MASK] = event;
+    SPSC_STORE(publishedHitEventCount, published + 1);
+}
+
+// Counts a hit on every frequency in mask, starts the lockout and records an
+// event for each of them, strongest first, stamped with tick.
+static void scoreHits(detector_hitMask_t mask, uint16_t strongestFrequency, uint32_t tick) {
+    lockoutTimer_start();
+    hitLedTimer_start();
+    double threshold = hitThreshold();
+    // The hits are the largest powers, so the walk down powerRank stops early.
+    detector_hitMask_t unrecorded = mask;
+    for (uint16_t i = FILTER_NUMBER; i-- > 0 && unrecorded;) {
+        uint16_t frequency = powerRank.frequency[i];
+        if (!(unrecorded & DETECTOR_HIT_BIT(frequency)))
+            continue;
+        unrecorded &= ~DETECTOR_HIT_BIT(frequency);
+        hitArray[frequency]++;
+        recordHitEvent((detector_hitEvent_t){powerRank.power[i],
+                                             powerRank.power[i] - threshold, tick, frequency});
+    }
+    lastHitFrequency = strongestFrequency;
+    hitDetectedFlag = true;
+}
+
+// Runs the filters, the power computation and hit detection over a block of
+// ADC samples whose first sample was taken on ISR tick firstTick. Used by
+// detector() and detector_runBlocks(). Per ADC sample this only feeds the
+// decimating FIR; the powers are sorted and checked for a hit once per
+// decimated output, when they change.
+static void processAdcBlock(const buffer_data_t adcBlock[], uint32_t blockSize,
+                            uint32_t firstTick) {
+    double firOutputs[FILTER_BLOCK_MAX_OUTPUT_COUNT(DETECTOR_BLOCK_SIZE)];
+    double powerValues[FILTER_FREQUENCY_COUNT];
+    // Tick of the sample that completes the first output of this block.
+    uint32_t outputTick = firstTick + FILTER_FIR_DECIMATION_FACTOR - 1 - filter_getDecimationPhase();
+    // The decimation phase lives in filter.c, so only every
+    // FILTER_FIR_DECIMATION_FACTOR-th sample across blocks yields an output.
+    uint32_t outputCount = filter_processBlock(adcBlock, blockSize, firOutputs);
+    DPRINTF("ADC block of %d samples, %d FIR outputs\n", blockSize, outputCount);
+    for (uint32_t j = 0; j < outputCount; j++, outputTick += FILTER_FIR_DECIMATION_FACTOR) {
+        filter_addFirOutput(firOutputs[j]);
+        filter_computeAllPowers(powerValues); // IIR bank + power, or Goertzel bins.
+        updatePowerView(powerValues);
+        uint16_t strongestFrequency = 0;
+        hitMask = findHits(&strongestFrequency);
+        if (hitMask && !ignoreAllHitsFlag && !lockoutTimer_running())
+            scoreHits(hitMask, strongestFrequency, outputTick);
+    }
 }
 
 // Runs the entire detector: decimating FIR-filter, IIR-filters,
-// power-computation, hit-detection. If interruptsCurrentlyEnabled = true,
-// interrupts are running. If interruptsCurrentlyEnabled = false you can pop
-// values from the ADC buffer without disabling interrupts. If
-// interruptsCurrentlyEnabled = true, do the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC buffer.
-// 3. re-enable interrupts.
+// power-computation, hit-detection. Drains the values that are in the ADC
+// buffer on entry, a block at a time with buffer_popMany(). The buffer is a
+// single-producer/single-consumer ring, so popping needs no interrupt masking
+// and interruptsCurrentlyEnabled no longer changes anything.
 // Ignore hits on frequencies specified with detector_setIgnoredFrequencies().
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled) {
-    uint64_t elementCount = buffer_elements();
-    for (uint64_t i = 0; i < elementCount; i++) {
-        uint8_t decimationFactor = 0;
-        if (interruptsCurrentlyEnabled)
-            interrupts_disableArmInts();
-        uint16_t rawAdcValue = buffer_pop();
-        if (interruptsCurrentlyEnabled)
-            interrupts_enableArmInts();
-        double scaledAdcValue = ((double)rawAdcValue - 2047.5)/2047.5;
-        DPRINTF("ADC value: %d, scaled ADC value: %f", rawAdcValue, scaledAdcValue);
-        filter_addNewInput(scaledAdcValue);
-        decimationFactor++;
-        if (DECIMATION_VAL == decimationFactor) {
-            filter_firFilter();
-            for (uint8_t filterNumber = 0; filterNumber < FILTER_NUMBER; filterNumber++) {
-                filter_iirFilter(filterNumber);
-                filter_computePower(filterNumber, true, false); //Check if we want to compute from scratch each time
-            }
-        }
-        if (lockoutTimer_running()) {
-            uint16_t freqHit = detector_getFrequencyNumberOfLastHit();
-            if (detector_hitDetected() && !freqArray[freqHit]) {
-                lockoutTimer_start();
-                hitLedTimer_start();
-                hitArray[freqHit]++;
-                hitDetectedFlag = true;
-            }
-        }
+    (void)interruptsCurrentlyEnabled; // Kept for API compatibility.
+    buffer_data_t adcBlock[DETECTOR_BLOCK_SIZE];
+    uint32_t elementCount = buffer_elements();
+    invocationCount++;
+    while (elementCount > 0) {
+        uint32_t blockSize = buffer_popMany(adcBlock, elementCount < DETECTOR_BLOCK_SIZE ? elementCount : DETECTOR_BLOCK_SIZE);
+        if (blockSize == 0)
+            break;
+        elementCount -= blockSize;
+        processAdcBlock(adcBlock, blockSize, buffer_getReadCount() - blockSize);
     }
+}
 
+// Block-capture version of detector(), for builds with ISR_BLOCK_CAPTURE.
+// Processes every block the ISR has published (see adcCapture.h) in place and
+// releases it. The latency of a block runs from the tick of its last sample
+// to the end of its processing; see detector_getBlockStats().
+void detector_runBlocks(void) {
+    const adcCapture_block_t *block;
+    invocationCount++;
+    while ((block = adcCapture_getReadyBlock()) != NULL) {
+        processAdcBlock(block->samples, ADC_CAPTURE_BLOCK_SIZE, block->firstTick);
+        uint32_t lastSampleTick = block->firstTick + ADC_CAPTURE_BLOCK_SIZE - 1;
+        adcCapture_releaseBlock();
+        blockStats.lastLatencyTicks = adcCapture_getTickCount() - lastSampleTick;
+        if (blockStats.lastLatencyTicks > blockStats.maxLatencyTicks)
+            blockStats.maxLatencyTicks = blockStats.lastLatencyTicks;
+        blockStats.totalLatencyTicks += blockStats.lastLatencyTicks;
+        blockStats.blockCount++;
+    }
+}
 
+// Returns the block count and latency statistics of detector_runBlocks().
+detector_blockStats_t detector_getBlockStats(void) {
+    return blockStats;
 }
 
 // Returns true if a hit was detected.
@@ -92,14 +259,65 @@ bool detector_hitDetected(void) {
     return hitDetectedFlag;
 }
 
-// Returns the frequency number that caused the hit.
+// Returns the frequency number that caused the hit. In multi-hit mode, the
+// one with the largest power.
 uint16_t detector_getFrequencyNumberOfLastHit(void) {
-    uint16_t freqHit = 0;
-    for (uint8_t i = 0; i < FILTER_NUMBER; i++) {
-        if (filter_getPower(i) > filter_getPower(freqHit))
-            freqHit = i;
+    return lastHitFrequency;
+}
+
+// Returns the powers of the newest decimated output ranked by
+// powerRank_sort(); read the strongest, second-strongest and median with the
+// powerRank_*() accessors.
+const powerRank_t *detector_getPowerRank(void) {
+    return &powerRank;
+}
+
+// Returns the hit mask of the newest decimated output: bit i is set if
+// frequency i was above the threshold and is not ignored, whether or not the
+// lockout or detector_ignoreAllHits() kept it from scoring.
+detector_hitMask_t detector_getHitMask(void) {
+    return hitMask;
+}
+
+// Moves up to maxCount hit events, oldest first, into events[] and returns
+// how many were moved. Copies at most two contiguous spans of the ring.
+uint16_t detector_takeHitEvents(detector_hitEvent_t events[], uint16_t maxCount) {
+    const detector_hitEvent_t *span;
+    uint16_t count = 0, spanCount;
+    while (count < maxCount && (spanCount = detector_peekHitEvents(&span)) > 0) {
+        if (spanCount > maxCount - count)
+            spanCount = maxCount - count;
+        for (uint16_t i = 0; i < spanCount; i++)
+            events[count + i] = span[i];
+        detector_releaseHitEvents(spanCount);
+        count += spanCount;
     }
-    return freqHit;
+    return count;
+}
+
+// Points *events at the oldest hit events without copying them and returns
+// how many there are in one contiguous span (0 if none; call again after
+// detector_releaseHitEvents() for the rest of a span that wraps). They stay
+// valid until detector_releaseHitEvents().
+uint16_t detector_peekHitEvents(const detector_hitEvent_t **events) {
+    uint32_t taken = takenHitEventCount; // Only the consumer writes it.
+    uint32_t slot = taken & HIT_EVENT_INDEX_MASK;
+    uint32_t count = SPSC_LOAD(publishedHitEventCount) - taken;
+    if (count > DETECTOR_HIT_EVENT_CAPACITY - slot)
+        count = DETECTOR_HIT_EVENT_CAPACITY - slot;
+    *events = &hitEvents[slot];
+    return count;
+}
+
+// Hands back the oldest count hit events, at most what
+// detector_peekHitEvents() returned.
+void detector_releaseHitEvents(uint16_t count) {
+    SPSC_STORE(takenHitEventCount, takenHitEventCount + count);
+}
+
+// Returns the number of hit events dropped because the ring was full.
+uint32_t detector_getDroppedHitEventCount(void) {
+    return SPSC_LOAD(droppedHitEventCount);
 }
 
 // Clear the detected hit once you have accounted for it.
@@ -110,9 +328,10 @@ void detector_clearHit(void) {
 // Ignore all hits. Used to provide some limited invincibility in some game
 // modes. The detector will ignore all hits if the flag is true, otherwise will
 // respond to hits normally.
+// Kept apart from the ignored frequencies, so that ending the invincibility
+// does not un-ignore the player's own frequency.
 void detector_ignoreAllHits(bool flagValue) {
-    for (uint8_t i = 0; i < FILTER_NUMBER; i++)
-        freqArray[i] = flagValue;
+    ignoreAllHitsFlag = flagValue;
 }
 
 // Get the current hit counts.
@@ -125,25 +344,148 @@ void detector_getHitCounts(detector_hitCount_t userHitArray[]) {
 
 // Allows the fudge-factor index to be set externally from the detector.
 // The actual values for fudge-factors is stored in an array found in detector.c
+// Indices past the end of that array pick its last (largest) fudge factor.
 void detector_setFudgeFactorIndex(uint32_t factor) {
-    fudgeFactorIndex = factor;
+    fudgeFactorIndex = (factor < FUDGE_FACTOR_COUNT) ? factor : FUDGE_FACTOR_COUNT - 1;
+    fudgeFactor = fudgeFactors[fudgeFactorIndex];
+}
+
+// Replaces the fudge factor at index in the array in detector.c, e.g. to tune
+// the threshold to the noise floor while the game runs. Takes effect at once
+// if index is the current fudge-factor index. Out-of-range indices are
+// ignored.
+void detector_setFudgeFactor(uint32_t index, double value) {
+    if (index >= FUDGE_FACTOR_COUNT)
+        return;
+    fudgeFactors[index] = value;
+    if (index == fudgeFactorIndex)
+        fudgeFactor = value;
+}
+
+// Returns the fudge factor that the hit threshold currently uses.
+double detector_getFudgeFactor(void) {
+    return fudgeFactor;
 }
 
 // Returns the detector invocation count.
 // The count is incremented each time detector is called.
 // Used for run-time statistics.
 uint32_t detector_getInvocationCount(void) {
-    return filter_getInvocationCount();
+    return invocationCount;
 }
 
 /******************************************************
 ******************** Test Routines ********************
 ******************************************************/
 
+// Fills the hit event ring past full, then drains it in batches across the
+// wrap with detector_takeHitEvents() and detector_peekHitEvents(). Events are
+// stamped with their recording order as tick. Leaves the ring empty. Returns
+// true if every event comes out once, in order, and the overflow is counted.
+static bool hitEventRingTest(void) {
+    detector_hitEvent_t events[DETECTOR_HIT_EVENT_CAPACITY + 1];
+    const detector_hitEvent_t *span;
+    uint32_t tick = 0, nextTick = 0;
+    bool testResult = true;
+    resetHitEvents();
+    while (tick < DETECTOR_HIT_EVENT_CAPACITY + DETECTOR_TEST_DROPPED_EVENT_COUNT) {
+        recordHitEvent((detector_hitEvent_t){1.0, 0.5, tick, tick % FILTER_NUMBER});
+        tick++;
+    }
+    testResult = testResult && detector_getDroppedHitEventCount() == DETECTOR_TEST_DROPPED_EVENT_COUNT;
+    // The newest events were dropped, so the ticks carry on after the kept ones.
+    tick = DETECTOR_HIT_EVENT_CAPACITY;
+    uint16_t count = detector_takeHitEvents(events, DETECTOR_HIT_EVENT_CAPACITY / 2);
+    for (uint16_t i = 0; i < DETECTOR_HIT_EVENT_CAPACITY / 2; i++)
+        recordHitEvent((detector_hitEvent_t){1.0, 0.5, tick++, 0});
+    // This batch wraps around the end of the ring.
+    count += detector_takeHitEvents(&events[count], DETECTOR_HIT_EVENT_CAPACITY + 1 - count);
+    testResult = testResult && count == DETECTOR_HIT_EVENT_CAPACITY + 1;
+    for (uint16_t i = 0; i < count; i++)
+        testResult = testResult && events[i].tick == nextTick++;
+    // Zero-copy drain of the events recorded after the first batch.
+    while ((count = detector_peekHitEvents(&span)) > 0) {
+        for (uint16_t i = 0; i < count; i++)
+            testResult = testResult && span[i].tick == nextTick++;
+        detector_releaseHitEvents(count);
+    }
+    testResult = testResult && nextTick == tick && detector_takeHitEvents(events, 1) == 0;
+    resetHitEvents();
+    return testResult;
+}
+
 // Students implement this as part of Milestone 3, Task 3.
 // Create two sets of power values and call your hit detection algorithm
 // on each set. With the same fudge factor, your hit detect algorithm
 // should detect a hit on the first set and not detect a hit on the second.
 void detector_runTest(void) {
-    
-}
\ No newline at end of file
+    // Frequency 3 stands far above a quiet floor in the first set and only
+    // somewhat above it in the second. The upper median of both is 30.
+    const double hitPowers[FILTER_NUMBER] = {20, 30, 10, 50000, 40, 25, 35, 15, 45, 30};
+    const double noHitPowers[FILTER_NUMBER] = {20, 30, 10, 5000, 40, 25, 35, 15, 45, 30};
+    // Frequencies 3 and 7 are both hits; the upper median is 35.
+    const double twoHitPowers[FILTER_NUMBER] = {20, 30, 10, 50000, 40, 25, 35, 20000, 45, 30};
+    const detector_hitMask_t twoHitMask = DETECTOR_HIT_BIT(3) | DETECTOR_HIT_BIT(7);
+    uint32_t savedFudgeFactorIndex = fudgeFactorIndex;
+    detector_hitMode_t savedHitMode = hitMode;
+    detector_hitMask_t savedIgnoredFrequencyMask = ignoredFrequencyMask;
+    uint16_t strongestFrequency = 0;
+    powerRank_init(&powerRank);
+    detector_setFudgeFactorIndex(0); // 30 * 400 = 12000, 35 * 400 = 14000.
+    ignoredFrequencyMask = 0;
+    hitMode = DETECTOR_HIT_MODE_SINGLE;
+    updatePowerView(hitPowers);
+    bool hitOnFirstSet = (findHits(&strongestFrequency) == DETECTOR_HIT_BIT(3));
+    updatePowerView(noHitPowers);
+    bool noHitOnSecondSet = (findHits(&strongestFrequency) == 0);
+    // Raising the fudge factor at run time turns the first set into a miss.
+    double savedFudgeFactor = fudgeFactors[0];
+    detector_setFudgeFactor(0, 2000.0); // 30 * 2000 = 60000.
+    updatePowerView(hitPowers);
+    bool tunedFudgeFactorPassed = (findHits(&strongestFrequency) == 0);
+    detector_setFudgeFactor(0, savedFudgeFactor);
+    tunedFudgeFactorPassed = tunedFudgeFactorPassed && (findHits(&strongestFrequency) != 0);
+    // The single-hit mode reports only the strongest of two hits.
+    updatePowerView(twoHitPowers);
+    bool singleHitPassed = (findHits(&strongestFrequency) == DETECTOR_HIT_BIT(3));
+    hitMode = DETECTOR_HIT_MODE_MULTI;
+    bool multiHitPassed = (findHits(&strongestFrequency) == twoHitMask) && strongestFrequency == 3;
+    // Ignoring frequency 3 leaves frequency 7 in multi-hit mode only.
+    ignoredFrequencyMask = DETECTOR_HIT_BIT(3);
+    multiHitPassed = multiHitPassed && findHits(&strongestFrequency) == DETECTOR_HIT_BIT(7) &&
+                     strongestFrequency == 7;
+    hitMode = DETECTOR_HIT_MODE_SINGLE;
+    singleHitPassed = singleHitPassed && findHits(&strongestFrequency) == 0;
+    // Invincibility comes and goes without touching the ignored frequencies.
+    bool savedIgnoreAllHitsFlag = ignoreAllHitsFlag;
+    detector_ignoreAllHits(true);
+    detector_ignoreAllHits(false);
+    bool invincibilityPassed = (ignoredFrequencyMask == DETECTOR_HIT_BIT(3));
+    ignoreAllHitsFlag = savedIgnoreAllHitsFlag;
+    // The ranking has to keep up with powers that drift and cross.
+    bool sortPassed = true;
+    double driftingPowers[FILTER_NUMBER];
+    for (uint16_t i = 0; i < FILTER_NUMBER; i++)
+        driftingPowers[i] = i;
+    for (uint16_t output = 0; output < DETECTOR_TEST_DRIFT_OUTPUT_COUNT && sortPassed; output++) {
+        for (uint16_t i = 0; i < FILTER_NUMBER; i++)
+            driftingPowers[i] += (rand() % 7) - 3;
+        updatePowerView(driftingPowers);
+        for (uint16_t i = 1; i < FILTER_NUMBER; i++)
+            if (powerRank.power[i - 1] > powerRank.power[i] ||
+                powerRank.power[i] != driftingPowers[powerRank.frequency[i]])
+                sortPassed = false;
+    }
+    powerRank_init(&powerRank);
+    detector_setFudgeFactorIndex(savedFudgeFactorIndex);
+    hitMode = savedHitMode;
+    ignoredFrequencyMask = savedIgnoredFrequencyMask;
+    printf("detector_runTest: hit on the first set %s, no hit on the second set %s\n",
+           hitOnFirstSet ? "passed" : "FAILED", noHitOnSecondSet ? "passed" : "FAILED");
+    printf("detector_runTest: single-hit mode %s, multi-hit mode %s\n",
+           singleHitPassed ? "passed" : "FAILED", multiHitPassed ? "passed" : "FAILED");
+    printf("detector_runTest: tuned fudge factor %s, ranking %s\n",
+           tunedFudgeFactorPassed ? "passed" : "FAILED", sortPassed ? "passed" : "FAILED");
+    printf("detector_runTest: hit event ring %s, invincibility %s\n",
+           hitEventRingTest() ? "passed" : "FAILED", invincibilityPassed ? "passed" : "FAILED");
+}
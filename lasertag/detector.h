@@ -14,8 +14,42 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "powerRank.h"
+
 typedef uint16_t detector_hitCount_t;
 
+// One bit per frequency: bit i stands for frequency number i.
+typedef uint16_t detector_hitMask_t;
+
+// Hit events the ring holds until a consumer takes them, a power of two.
+#define DETECTOR_HIT_EVENT_CAPACITY 16
+
+// How many frequencies one decimated output can report.
+typedef enum {
+  DETECTOR_HIT_MODE_SINGLE, // Only the largest power, if above the threshold (default).
+  DETECTOR_HIT_MODE_MULTI   // Every power above the threshold.
+} detector_hitMode_t;
+
+// One frequency scored as a hit on one decimated output. In multi-hit mode an
+// output can record several events with the same tick, strongest first.
+typedef struct {
+  double power;           // Power of the frequency.
+  double thresholdMargin; // Power minus the hit threshold, always positive.
+  // ISR tick of the ADC sample that completed the decimated output, counted
+  // since isr_init() (buffer_getReadCount() or adcCapture_getTickCount()).
+  uint32_t tick;
+  uint16_t frequency; // Frequency number.
+} detector_hitEvent_t;
+
+// Timing of detector_runBlocks(), in 100 kHz ISR ticks. A block's latency
+// runs from its last sample to the end of its processing.
+typedef struct {
+  uint32_t blockCount;         // Blocks processed.
+  uint32_t lastLatencyTicks;   // Latency of the newest block.
+  uint32_t maxLatencyTicks;    // Largest latency seen.
+  uint64_t totalLatencyTicks;  // Sum of all latencies, for the mean.
+} detector_blockStats_t;
+
 // Initialize the detector module.
 // By default, all frequencies are considered for hits.
 // Assumes the filter module is initialized previously.
@@ -26,24 +60,70 @@ void detector_init(void);
 // Your shot frequency (based on the switches) is a good choice to ignore.
 void detector_setIgnoredFrequencies(bool freqArray[]);
 
+// Picks how many frequencies one decimated output can report, see
+// detector_hitMode_t.
+void detector_setHitMode(detector_hitMode_t mode);
+
 // Runs the entire detector: decimating FIR-filter, IIR-filters,
-// power-computation, hit-detection. If interruptsCurrentlyEnabled = true,
-// interrupts are running. If interruptsCurrentlyEnabled = false you can pop
-// values from the ADC buffer without disabling interrupts. If
-// interruptsCurrentlyEnabled = true, do the following:
-// 1. disable interrupts.
-// 2. pop the value from the ADC buffer.
-// 3. re-enable interrupts.
+// power-computation, hit-detection. Drains the values that are in the ADC
+// buffer on entry, a block at a time with buffer_popMany(). The buffer is a
+// single-producer/single-consumer ring, so popping needs no interrupt masking
+// and interruptsCurrentlyEnabled no longer changes anything.
 // Ignore hits on frequencies specified with detector_setIgnoredFrequencies().
 // Assumption: draining the ADC buffer occurs faster than it can fill.
 void detector(bool interruptsCurrentlyEnabled);
 
+// Block-capture version of detector(), for builds with ISR_BLOCK_CAPTURE.
+// Processes every block the ISR has published (see adcCapture.h) in place and
+// releases it. The latency of a block runs from the tick of its last sample
+// to the end of its processing; see detector_getBlockStats().
+void detector_runBlocks(void);
+
+// Returns the block count and latency statistics of detector_runBlocks().
+detector_blockStats_t detector_getBlockStats(void);
+
 // Returns true if a hit was detected.
 bool detector_hitDetected(void);
 
-// Returns the frequency number that caused the hit.
+// Returns the frequency number that caused the hit. In multi-hit mode, the
+// one with the largest power.
 uint16_t detector_getFrequencyNumberOfLastHit(void);
 
+// Returns the powers of the newest decimated output ranked by
+// powerRank_sort(); read the strongest, second-strongest and median with the
+// powerRank_*() accessors.
+const powerRank_t *detector_getPowerRank(void);
+
+// Returns the hit mask of the newest decimated output: bit i is set if
+// frequency i was above the threshold and is not ignored, whether or not the
+// lockout or detector_ignoreAllHits() kept it from scoring.
+detector_hitMask_t detector_getHitMask(void);
+
+// Hit events are kept in a single-producer/single-consumer ring: the code
+// that runs the detector records one event per frequency scored as a hit
+// (outside the lockout), and one consumer, e.g. the game or the telemetry,
+// drains them in batches. Each side owns its own count, so neither locks or
+// masks interrupts. Unlike hitDetectedFlag, hits that arrive before the
+// consumer gets to them are all kept, with their timing. If the ring is full
+// the new events are dropped and counted.
+
+// Moves up to maxCount hit events, oldest first, into events[] and returns
+// how many were moved.
+uint16_t detector_takeHitEvents(detector_hitEvent_t events[], uint16_t maxCount);
+
+// Points *events at the oldest hit events without copying them and returns
+// how many there are in one contiguous span (0 if none; call again after
+// detector_releaseHitEvents() for the rest of a span that wraps). They stay
+// valid until detector_releaseHitEvents().
+uint16_t detector_peekHitEvents(const detector_hitEvent_t **events);
+
+// Hands back the oldest count hit events, at most what
+// detector_peekHitEvents() returned.
+void detector_releaseHitEvents(uint16_t count);
+
+// Returns the number of hit events dropped because the ring was full.
+uint32_t detector_getDroppedHitEventCount(void);
+
 // Clear the detected hit once you have accounted for it.
 void detector_clearHit(void);
 
@@ -59,8 +139,18 @@ void detector_getHitCounts(detector_hitCount_t hitArray[]);
 
 // Allows the fudge-factor index to be set externally from the detector.
 // The actual values for fudge-factors is stored in an array found in detector.c
+// Indices past the end of that array pick its last (largest) fudge factor.
 void detector_setFudgeFactorIndex(uint32_t factor);
 
+// Replaces the fudge factor at index in the array in detector.c, e.g. to tune
+// the threshold to the noise floor while the game runs. Takes effect at once
+// if index is the current fudge-factor index. Out-of-range indices are
+// ignored.
+void detector_setFudgeFactor(uint32_t index, double value);
+
+// Returns the fudge factor that the hit threshold currently uses.
+double detector_getFudgeFactor(void);
+
 // Returns the detector invocation count.
 // The count is incremented each time detector is called.
 // Used for run-time statistics.
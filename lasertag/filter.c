@@ -1,5 +1,13 @@
 #include "filter.h"
-#include <math.h>
+#include "biquad.h"
+#include "fir.h"
+#include "goertzel.h"
+#include "powerTracker.h"
+#include <stdio.h>
+
+#ifdef FILTER_FIXED_POINT
+#include "filterFixed.h"
+#endif
 
 // Filtering routines for the laser-tag project.
 // Filtering is performed by a two-stage filter, as described below.
@@ -21,19 +29,70 @@
 #define IIR_A_COEFFICIENT_COUNT 10
 #define IIR_B_COEFFICIENT_COUNT 11
 #define NUM_OF_PLAYERS 10
-#define X_QUEUE_SIZE FIR_B_COEFFICIENT_COUNT
 #define Y_QUEUE_SIZE IIR_B_COEFFICIENT_COUNT
 #define Z_QUEUE_SIZE IIR_A_COEFFICIENT_COUNT
 #define OUTPUT_QUEUE_SIZE 2000
-#define POW_OF_TWO 2
-
-// Global Variables
-static queue_t xQueue;	
-static queue_t yQueue;	
-static queue_t zQueue[FILTER_IIR_FILTER_COUNT];
-static queue_t outputQueue[FILTER_IIR_FILTER_COUNT];
-static double currentPowerValue[NUM_OF_PLAYERS];
-static double oldestPowerValue[NUM_OF_PLAYERS];
+#define FILTER_POWER_RESYNC_INTERVAL OUTPUT_QUEUE_SIZE // Exact sum once per window.
+// Smoothing factor of FILTER_POWER_EMA. An N-sample moving average and an
+// exponential average with alpha = 2 / (N + 1) give their samples the same
+// mean age, (N - 1) / 2. N is 20 ms of decimated outputs: an average as long
+// as the 200 ms output queue still holds 4% of a shot's power 300 ms after the
+// shot ends and re-triggers the detector when its lockout expires.
+#define EMA_WINDOW_LENGTH 200
+#define EMA_ALPHA (2.0 / (EMA_WINDOW_LENGTH + 1))
+// FILTER_POWER_GOERTZEL recomputes its bins from the history every 10 windows.
+#define GOERTZEL_RESYNC_INTERVAL (10 * OUTPUT_QUEUE_SIZE)
+#define ADC_MIDSCALE 2047.5 // Center of the 12-bit unipolar ADC range.
+
+// Cortex-A9 L1 and L2 cache line size. The filter state starts on a line.
+#define FILTER_CACHE_LINE_SIZE 32
+#define Y_QUEUE_STORAGE_LENGTH QUEUE_MIRRORED_STORAGE_LENGTH(Y_QUEUE_SIZE)
+#define Z_QUEUE_STORAGE_LENGTH QUEUE_MIRRORED_STORAGE_LENGTH(Z_QUEUE_SIZE)
+#define OUTPUT_QUEUE_STORAGE_LENGTH QUEUE_POWER_OF_TWO_STORAGE_LENGTH(OUTPUT_QUEUE_SIZE)
+
+// All state kept between calls, in one statically allocated block: the
+// queues use the storage arrays below (queue_initInStorage()), so nothing is
+// malloc'd and calling filter_init() again reuses the same memory. Members
+// touched for every FIR output come first; the large histories come last.
+// filter_printRamBudget() lists the size of each member.
+typedef struct {
+    uint32_t decimationPhase; // ADC samples since the last FIR output.
+    filter_powerMode_t powerMode;
+    // True when iirBankHistory holds the newest outputs and the zQueues are
+    // stale. The state moves lazily between the two when the caller switches
+    // between filter_iirFilterAll() and filter_iirFilter().
+    bool iirBankOwnsState;
+    uint32_t iirBankNewestRow;
+    double currentPowerValue[NUM_OF_PLAYERS];
+    double oldestPowerValue[NUM_OF_PLAYERS];
+    // FILTER_POWER_EMA state: mean square of the IIR outputs and the newest output.
+    double emaPower[NUM_OF_PLAYERS];
+    double newestIirOutput[FILTER_IIR_FILTER_COUNT];
+    powerTracker_t powerTracker[NUM_OF_PLAYERS]; // Running sums of squares.
+    queue_t yQueue;
+    queue_t zQueue[FILTER_IIR_FILTER_COUNT];
+    queue_t outputQueue[FILTER_IIR_FILTER_COUNT];
+    // Direct-form IIR bank state for filter_iirFilterAll(), interleaved by
+    // channel so that each inner loop runs across the 10 filters.
+    // iirBankB[i][channel] == iirBCoefficientConstants[channel][i], same for A.
+    double iirBankB[Y_QUEUE_SIZE][FILTER_IIR_FILTER_COUNT];
+    double iirBankA[Z_QUEUE_SIZE][FILTER_IIR_FILTER_COUNT];
+    // Mirrored output history, one row per output and one column per channel.
+    // Each row is stored at iirBankNewestRow and iirBankNewestRow + Z_QUEUE_SIZE,
+    // so the last Z_QUEUE_SIZE rows are always contiguous (see fir.h).
+    double iirBankHistory[2 * Z_QUEUE_SIZE][FILTER_IIR_FILTER_COUNT];
+#ifdef FILTER_IIR_BIQUAD
+    biquad_bank_t iirBank; // All cascades, one lane per filter.
+#endif
+    fir_t fir; // Input history of the FIR-filter.
+    queue_data_t yQueueStorage[Y_QUEUE_STORAGE_LENGTH];
+    queue_data_t zQueueStorage[FILTER_IIR_FILTER_COUNT][Z_QUEUE_STORAGE_LENGTH];
+    goertzel_bank_t goertzelBank; // FILTER_POWER_GOERTZEL bins.
+    // Only filled with FILTER_POWER_SLIDING_WINDOW.
+    queue_data_t outputQueueStorage[FILTER_IIR_FILTER_COUNT][OUTPUT_QUEUE_STORAGE_LENGTH];
+} filter_state_t;
+
+static filter_state_t filterState __attribute__((aligned(FILTER_CACHE_LINE_SIZE)));
 
 // FIR Filter Coefficients
 const static double firCoefficients[FIR_B_COEFFICIENT_COUNT] = {
@@ -147,91 +206,381 @@ const static double iirBCoefficientConstants[FILTER_FREQUENCY_COUNT][IIR_B_COEFF
 {9.0928661148206091e-10, 0.0000000000000000e+00, -4.5464330574103047e-09, 0.0000000000000000e+00, 9.0928661148206094e-09, 0.0000000000000000e+00, -9.0928661148206094e-09, 0.0000000000000000e+00, 4.5464330574103047e-09, 0.0000000000000000e+00, -9.0928661148206091e-10}
 };
 
-// XQueue initialization helper function.
-static void initXQueue() {
-    queue_init(&xQueue, X_QUEUE_SIZE, "xQueue");
-
-    // Initialize the queue with 0.0.
-    for (uint32_t i = 0; i < X_QUEUE_SIZE; i++)
-        queue_overwritePush(&xQueue, 0.0);
-}
+// The same IIR filters as cascades of second-order sections, {b0, b1, b2, a1,
+// a2} with a0 == 1, least resonant section first. Generated from the tables
+// above with tools/iir2sos.py --format float.
+const static biquad_section_t iirSections[FILTER_FREQUENCY_COUNT][FILTER_IIR_SECTION_COUNT] = {
+    {
+        {1.546824696e-02f, 0.000000000e+00f, -1.546824696e-02f, -1.186368061e+00f, 9.690674295e-01f},
+        {1.394949823e-02f, 0.000000000e+00f, -1.394949823e-02f, -1.175123937e+00f, 9.747302130e-01f},
+        {1.724968499e-02f, 0.000000000e+00f, -1.724968499e-02f, -1.204443559e+00f, 9.750757882e-01f},
+        {9.362441702e-03f, 0.000000000e+00f, -9.362441702e-03f, -1.175120808e+00f, 9.902318072e-01f},
+        {2.609340880e-02f, 0.000000000e+00f, -2.609340880e-02f, -1.222716342e+00f, 9.904485930e-01f},
+    },
+    {
+        {1.546656526e-02f, 0.000000000e+00f, -1.546656526e-02f, -9.225923533e-01f, 9.690673961e-01f},
+        {1.392687059e-02f, 0.000000000e+00f, -1.392687059e-02f, -9.090805888e-01f, 9.747816512e-01f},
+        {1.727653920e-02f, 0.000000000e+00f, -1.727653920e-02f, -9.414168145e-01f, 9.750243624e-01f},
+        {9.320895291e-03f, 0.000000000e+00f, -9.320895291e-03f, -9.060481126e-01f, 9.902640321e-01f},
+        {2.621434429e-02f, 0.000000000e+00f, -2.621434429e-02f, -9.586568428e-01f, 9.904163680e-01f},
+    },
+    {
+        {1.546634220e-02f, 0.000000000e+00f, -1.546634220e-02f, -6.085503687e-01f, 9.690674163e-01f},
+        {1.389791454e-02f, 0.000000000e+00f, -1.389791454e-02f, -5.929357663e-01f, 9.748286298e-01f},
+        {1.731238685e-02f, 0.000000000e+00f, -1.731238685e-02f, -6.276692230e-01f, 9.749773571e-01f},
+        {9.295312248e-03f, 0.000000000e+00f, -9.295312248e-03f, -5.866955678e-01f, 9.902935287e-01f},
+        {2.628709615e-02f, 0.000000000e+00f, -2.628709615e-02f, -6.432808657e-01f, 9.903868645e-01f},
+    },
+    {
+        {1.546904401e-02f, 0.000000000e+00f, -1.546904401e-02f, -2.799280551e-01f, 9.690674192e-01f},
+        {1.387600250e-02f, 0.000000000e+00f, -1.387600250e-02f, -2.626782289e-01f, 9.748701251e-01f},
+        {1.734159948e-02f, 0.000000000e+00f, -1.734159948e-02f, -2.987898105e-01f, 9.749358550e-01f},
+        {9.268662395e-03f, 0.000000000e+00f, -9.268662395e-03f, -2.534549094e-01f, 9.903195695e-01f},
+        {2.635522551e-02f, 0.000000000e+00f, -2.635522551e-02f, -3.123239147e-01f, 9.903608213e-01f},
+    },
+    {
+        {1.546918376e-02f, 0.000000000e+00f, -1.546918376e-02f, 1.631435670e-01f, 9.690674203e-01f},
+        {1.386803247e-02f, 0.000000000e+00f, -1.386803247e-02f, 1.454381023e-01f, 9.748839641e-01f},
+        {1.735166314e-02f, 0.000000000e+00f, -1.735166314e-02f, 1.817884703e-01f, 9.749220143e-01f},
+        {9.260319774e-03f, 0.000000000e+00f, -9.260319774e-03f, 1.352371866e-01f, 9.903282555e-01f},
+        {2.637858264e-02f, 0.000000000e+00f, -2.637858264e-02f, 1.945017349e-01f, 9.903521349e-01f},
+    },
+    {
+        {1.546675538e-02f, 0.000000000e+00f, -1.546675538e-02f, 5.387173452e-01f, 9.690674219e-01f},
+        {1.389643614e-02f, 0.000000000e+00f, -1.389643614e-02f, 5.227099039e-01f, 9.748378960e-01f},
+        {1.731451623e-02f, 0.000000000e+00f, -1.731451623e-02f, 5.578268927e-01f, 9.749680851e-01f},
+        {9.286885168e-03f, 0.000000000e+00f, -9.286885168e-03f, 5.158059128e-01f, 9.902993485e-01f},
+        {2.630980967e-02f, 0.000000000e+00f, -2.630980967e-02f, 5.730269311e-01f, 9.903810431e-01f},
+    },
+    {
+        {1.547092594e-02f, 0.000000000e+00f, -1.547092594e-02f, 9.842979968e-01f, 9.690674520e-01f},
+        {1.392627869e-02f, 0.000000000e+00f, -1.392627869e-02f, 9.712709152e-01f, 9.747708980e-01f},
+        {1.728030575e-02f, 0.000000000e+00f, -1.728030575e-02f, 1.002992931e+00f, 9.750350709e-01f},
+        {9.333536587e-03f, 0.000000000e+00f, -9.333536587e-03f, 9.689163419e-01f, 9.902573150e-01f},
+        {2.616686843e-02f, 0.000000000e+00f, -2.616686843e-02f, 1.020505340e+00f, 9.904230773e-01f},
+    },
+    {
+        {1.546643058e-02f, 0.000000000e+00f, -1.546643058e-02f, 1.227430294e+00f, 9.690673548e-01f},
+        {1.396000484e-02f, 0.000000000e+00f, -1.396000484e-02f, 1.216589736e+00f, 9.747205650e-01f},
+        {1.723542314e-02f, 0.000000000e+00f, -1.723542314e-02f, 1.245338804e+00f, 9.750855067e-01f},
+        {9.357790477e-03f, 0.000000000e+00f, -9.357790477e-03f, 1.217092356e+00f, 9.902257419e-01f},
+        {2.611138234e-02f, 0.000000000e+00f, -2.611138234e-02f, 1.263738145e+00f, 9.904546680e-01f},
+    },
+    {
+        {1.546628398e-02f, 0.000000000e+00f, -1.546628398e-02f, 1.473923838e+00f, 9.690674518e-01f},
+        {1.400127189e-02f, 0.000000000e+00f, -1.400127189e-02f, 1.465879765e+00f, 9.746446068e-01f},
+        {1.718455145e-02f, 0.000000000e+00f, -1.718455145e-02f, 1.490454996e+00f, 9.751614206e-01f},
+        {9.403689420e-03f, 0.000000000e+00f, -9.403689420e-03f, 1.469675947e+00f, 9.901781329e-01f},
+        {2.598428969e-02f, 0.000000000e+00f, -2.598428969e-02f, 1.509356740e+00f, 9.905022710e-01f},
+    },
+    {
+        {1.546663655e-02f, 0.000000000e+00f, -1.546663655e-02f, 1.705679710e+00f, 9.690673477e-01f},
+        {1.408116776e-02f, 0.000000000e+00f, -1.408116776e-02f, 1.701130355e+00f, 9.745054424e-01f},
+        {1.708718267e-02f, 0.000000000e+00f, -1.708718267e-02f, 1.720049002e+00f, 9.753008455e-01f},
+        {9.487971781e-03f, 0.000000000e+00f, -9.487971781e-03f, 1.708646646e+00f, 9.900916339e-01f},
+        {2.575267797e-02f, 0.000000000e+00f, -2.575267797e-02f, 1.738799866e+00f, 9.905887429e-01f},
+    },
+};
 
 // YQueue initialization helper function.
 static void initYQueue() {
-    queue_init(&yQueue, Y_QUEUE_SIZE, "yQueue");
+    queue_initInStorage(&filterState.yQueue, Y_QUEUE_SIZE, QUEUE_LAYOUT_MIRRORED,
+                        filterState.yQueueStorage, "yQueue");
 
     // Initialize the queue with 0.0.
-    for (uint32_t j = 0; j < Y_QUEUE_SIZE; j++)
-        queue_overwritePush(&yQueue, QUEUE_INIT_VALUE);
+    queue_fill(&filterState.yQueue, QUEUE_INIT_VALUE);
 }
 
 // ZQueue initialization helper function.
 static void initZQueues() {
     // Loop through all of the zQueues.
-    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) {
-        queue_init(&(zQueue[i]), Z_QUEUE_SIZE, "zQueue");
+    for (uint32_t i = 0; i < FILTER_IIR_FILTER_COUNT; i++) {
+        queue_initInStorage(&(filterState.zQueue[i]), Z_QUEUE_SIZE, QUEUE_LAYOUT_MIRRORED,
+                            filterState.zQueueStorage[i], "zQueue");
         // Initialize each zQueue with 0.0.
-        for (uint32_t j = 0; j < Z_QUEUE_SIZE; j++)
-            queue_overwritePush(&(zQueue[i]), QUEUE_INIT_VALUE);
+        queue_fill(&(filterState.zQueue[i]), QUEUE_INIT_VALUE);
     }
 }
 
-// OutputQueue initialization helper function.
+// OutputQueue initialization helper function. The queues are only filled for
+// FILTER_POWER_SLIDING_WINDOW; the leaky integrator and the Goertzel bins need
+// no output history, so their storage stays untouched and out of the cache.
+// Not mirrored: the power is only read a whole window at a time on a resync,
+// which can take two spans, so each push stores once instead of twice.
 static void initOutputQueues() {
     // Loop through all of the outputQueues.
     for (uint32_t i = 0; i < FILTER_IIR_FILTER_COUNT; i++) {
-        queue_init(&(outputQueue[i]), OUTPUT_QUEUE_SIZE, "outputQueue");
+        queue_initInStorage(&(filterState.outputQueue[i]), OUTPUT_QUEUE_SIZE,
+                            QUEUE_LAYOUT_POWER_OF_TWO, filterState.outputQueueStorage[i],
+                            "outputQueue");
         // Initialize each outputQueue with 0.0.
-        for (uint32_t j = 0; j < OUTPUT_QUEUE_SIZE; j++)
-            queue_overwritePush(&(zQueue[i]), QUEUE_INIT_VALUE);
+        if (filterState.powerMode == FILTER_POWER_SLIDING_WINDOW)
+            queue_fill(&(filterState.outputQueue[i]), QUEUE_INIT_VALUE);
     }
 }
 
+// IIR bank initialization helper function. Interleaves the coefficients.
+static void initIirBank() {
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++) {
+        for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++)
+            filterState.iirBankB[i][channel] = iirBCoefficientConstants[channel][i];
+        for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++)
+            filterState.iirBankA[i][channel] = iirACoefficientConstants[channel][i];
+    }
+    filterState.iirBankOwnsState = false; // The zQueues were just filled with zeros.
+#ifdef FILTER_IIR_BIQUAD
+    biquad_bankInit(&filterState.iirBank, &iirSections[0][0], FILTER_IIR_FILTER_COUNT,
+                    FILTER_IIR_SECTION_COUNT);
+#endif
+}
+
+// Copies the zQueues into the bank history (oldest first).
+static void loadIirBankFromZQueues() {
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++) {
+        const queue_data_t *zHistory; // Oldest first.
+        queue_window(&filterState.zQueue[channel], Z_QUEUE_SIZE, &zHistory);
+        for (uint32_t row = 0; row < Z_QUEUE_SIZE; row++) {
+            filterState.iirBankHistory[row][channel] = zHistory[row];
+            filterState.iirBankHistory[row + Z_QUEUE_SIZE][channel] = zHistory[row];
+        }
+    }
+    filterState.iirBankNewestRow = Z_QUEUE_SIZE - 1;
+    filterState.iirBankOwnsState = true;
+}
+
+// Pushes the bank history back onto the zQueues if the bank owns the state.
+static void syncZQueues() {
+    if (!filterState.iirBankOwnsState)
+        return;
+    const double(*window)[FILTER_IIR_FILTER_COUNT] =
+        &filterState.iirBankHistory[filterState.iirBankNewestRow + 1];
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++) {
+        double zHistory[Z_QUEUE_SIZE]; // One column of the window.
+        for (uint32_t row = 0; row < Z_QUEUE_SIZE; row++)
+            zHistory[row] = window[row][channel];
+        queue_overwritePushMany(&filterState.zQueue[channel], zHistory, Z_QUEUE_SIZE);
+    }
+    filterState.iirBankOwnsState = false;
+}
+
 // Must call this prior to using any filter functions.
+// Same as filter_initWithPowerMode(FILTER_POWER_SLIDING_WINDOW).
 void filter_init() {
+    filter_initWithPowerMode(FILTER_POWER_SLIDING_WINDOW);
+}
+
+// Initializes the filters with the chosen power estimator. The outputQueues
+// are only filled for FILTER_POWER_SLIDING_WINDOW. All state is static, so
+// calling this again allocates nothing.
+void filter_initWithPowerMode(filter_powerMode_t mode) {
   // Init queues and fill them with 0s.
-  initXQueue();  // Call queue_init() on xQueue and fill it with zeros.
-  initYQueue();  // Call queue_init() on yQueue and fill it with zeros.
-  initZQueues(); // Call queue_init() on all of the zQueues and fill each z queue with zeros.
-  initOutputQueues();  // Call queue_init() on all of the outputQueues and fill each outputQueue with zeros.
+  fir_init(&filterState.fir, firCoefficients, FIR_B_COEFFICIENT_COUNT); // Load the coefficients and zero the history.
+  initYQueue();  // Call queue_initInStorage() on yQueue and fill it with zeros.
+  initZQueues(); // Call queue_initInStorage() on all of the zQueues and fill each z queue with zeros.
+  filterState.powerMode = mode;
+  initOutputQueues(); // Call queue_initInStorage() on all of the outputQueues, zero-filled for the sliding window.
+  if (mode == FILTER_POWER_GOERTZEL)
+    goertzel_init(&filterState.goertzelBank, filter_frequencyTickTable, FILTER_FREQUENCY_COUNT,
+                  FILTER_FIR_DECIMATION_FACTOR, OUTPUT_QUEUE_SIZE,
+                  GOERTZEL_RESYNC_INTERVAL);
+  initIirBank(); // Interleave the IIR coefficients for filter_iirFilterAll().
+  for (uint32_t i = 0; i < NUM_OF_PLAYERS; i++) {
+    powerTracker_init(&filterState.powerTracker[i], OUTPUT_QUEUE_SIZE, FILTER_POWER_RESYNC_INTERVAL);
+    filterState.currentPowerValue[i] = 0.0;
+    filterState.oldestPowerValue[i] = 0.0;
+    filterState.emaPower[i] = 0.0;
+    filterState.newestIirOutput[i] = 0.0;
+  }
+  filterState.decimationPhase = 0;
+#ifdef FILTER_FIXED_POINT
+  filterFixed_init();
+#endif
 }
 
-// Use this to copy an input into the input queue of the FIR-filter (xQueue).
+// Use this to copy an input into the input history of the FIR-filter.
 void filter_addNewInput(double x) {
-    queue_overwritePush(&xQueue, x);
+#ifdef FILTER_FIXED_POINT
+    filterFixed_addNewInput(filterFixed_fromDouble(x));
+#else
+    fir_addNewInput(&filterState.fir, x);
+#endif
 }
 
-// Invokes the FIR-filter. Input is contents of xQueue.
+// Invokes the FIR-filter. Input is the FIR input history.
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter() {
-    double y = 0.0;
-    
-    // Compute the next y using a for loop and use += to accumulate the result
-    for (uint32_t i = 0; i < FIR_B_COEFFICIENT_COUNT; i++) // iteratively adds the (b * input) products.
-        y += queue_readElementAt(&xQueue, FIR_B_COEFFICIENT_COUNT-1-i) * firCoefficients[i];
-
-    queue_overwritePush(&yQueue, y); // Push the results onto y
+#ifdef FILTER_FIXED_POINT
+    return filterFixed_signalToDouble(filterFixed_firFilter());
+#endif
+    // The history is a contiguous array, so this is a single SIMD dot product.
+    // The lowpass coefficients are symmetric, so fir.c runs it folded.
+    double y = fir_compute(&filterState.fir);
+
+    queue_overwritePushFast(&filterState.yQueue, y); // Push the results onto y
     return y;
 }
 
+// Block version of filter_addNewInput() + filter_firFilter() for raw ADC
+// samples. Scales n ADC values to [-1.0, 1.0], runs the decimating FIR over
+// them and writes only the decimated outputs to firOutputs, which must hold
+// FILTER_BLOCK_MAX_OUTPUT_COUNT(n) values. Returns the number of outputs.
+// The decimation phase carries over between calls (filter_init() resets it),
+// so the block size does not change the outputs. Nothing is pushed onto
+// yQueue; hand each output to filter_addFirOutput() before running the IIR
+// filters on it.
+uint32_t filter_processBlock(const buffer_data_t *adc, size_t n,
+                             double firOutputs[]) {
+    uint32_t outputCount = 0;
+#ifdef FILTER_FIXED_POINT
+    for (size_t i = 0; i < n; i++) {
+        filterFixed_addNewInput(filterFixed_fromAdc(adc[i]));
+        if (++filterState.decimationPhase == FILTER_FIR_DECIMATION_FACTOR) {
+            filterState.decimationPhase = 0;
+            firOutputs[outputCount++] =
+                filterFixed_signalToDouble(filterFixed_firFilter());
+        }
+    }
+    return outputCount;
+#endif
+    double samples[FIR_DECIMATE_CHUNK_SIZE];
+    while (n > 0) {
+        uint32_t chunk = n < FIR_DECIMATE_CHUNK_SIZE ? n : FIR_DECIMATE_CHUNK_SIZE;
+        for (uint32_t i = 0; i < chunk; i++)
+            samples[i] = ((double)adc[i] - ADC_MIDSCALE) * (1.0 / ADC_MIDSCALE);
+        outputCount += fir_decimate(&filterState.fir, samples, chunk,
+                                    FILTER_FIR_DECIMATION_FACTOR,
+                                    &filterState.decimationPhase, &firOutputs[outputCount]);
+        adc += chunk;
+        n -= chunk;
+    }
+    return outputCount;
+}
+
+// Pushes a FIR output computed by filter_processBlock() onto yQueue, so that
+// the next filter_iirFilter() calls use it as their newest input.
+void filter_addFirOutput(double y) {
+#ifdef FILTER_FIXED_POINT
+    filterFixed_addFirOutput(filterFixed_signalFromDouble(y));
+    return;
+#endif
+    queue_overwritePushFast(&filterState.yQueue, y);
+}
+
+// Returns the ADC samples filter_processBlock() has taken since its last
+// decimated output. Output k of the next block comes from its sample
+// FILTER_FIR_DECIMATION_FACTOR - 1 - phase + k * FILTER_FIR_DECIMATION_FACTOR.
+uint32_t filter_getDecimationPhase(void) {
+    return filterState.decimationPhase;
+}
+
+// Keeps an IIR output for the power computation: pushed onto the outputQueue
+// for FILTER_POWER_SLIDING_WINDOW, held for the next filter_computePower()
+// call for FILTER_POWER_EMA.
+static void recordIirOutput(uint32_t filterNumber, double z) {
+    filterState.newestIirOutput[filterNumber] = z;
+    if (filterState.powerMode == FILTER_POWER_SLIDING_WINDOW)
+        queue_overwritePushFast(&filterState.outputQueue[filterNumber], z);
+}
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber) {
+#ifdef FILTER_FIXED_POINT
+    return filterFixed_signalToDouble(filterFixed_iirFilter(filterNumber));
+#endif
+#ifdef FILTER_IIR_BIQUAD
+    // The cascade keeps its own state; only the newest FIR output is needed.
+    double z = biquad_bankFilterLane(&filterState.iirBank, filterNumber,
+                                     (float)queue_readElementAtFast(&filterState.yQueue, Y_QUEUE_SIZE - 1));
+#else
+    syncZQueues(); // Take the state back if filter_iirFilterAll() ran last.
     double z = 0.0;
+    // Both queues are always full, oldest element first.
+    const queue_data_t *y, *zHistory;
+    queue_window(&filterState.yQueue, Y_QUEUE_SIZE, &y);
+    queue_window(&filterState.zQueue[filterNumber], Z_QUEUE_SIZE, &zHistory);
 
     // This for-loop performs the identical computation to that shown above.
     for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++) // iteratively adds the (b * input) products.
-        z += queue_readElementAt(&yQueue, Y_QUEUE_SIZE-1-i) * iirBCoefficientConstants[filterNumber][i];
+        z += y[Y_QUEUE_SIZE-1-i] * iirBCoefficientConstants[filterNumber][i];
 
     // Read the zQueue and remove the results to z.
     for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++) // iteratively adds the (b * input) products.
-        z -= queue_readElementAt(&zQueue[filterNumber], Z_QUEUE_SIZE-1-i) * iirACoefficientConstants[filterNumber][i];
+        z -= zHistory[Z_QUEUE_SIZE-1-i] * iirACoefficientConstants[filterNumber][i];
+#endif
 
-    queue_overwritePush(&outputQueue[filterNumber], z); // Push the results onto the outputQueue
-    queue_overwritePush(&zQueue[filterNumber], z); // Push the results onto the zQueue
+    recordIirOutput(filterNumber, z); // Push the results onto the outputQueue
+    queue_overwritePushFast(&filterState.zQueue[filterNumber], z); // Push the results onto the zQueue
     return z;
 }
 
+// Runs all FILTER_FREQUENCY_COUNT IIR filters on the newest yQueue value in one
+// pass and writes their outputs to iirOutputs[]. Equivalent to calling
+// filter_iirFilter() for every filter number, with the same outputs, but the
+// coefficients and the filter histories are interleaved by channel, so yQueue
+// is read once and every multiply-accumulate loop runs across the channels.
+// Outputs are pushed onto the outputQueues; the zQueues are only brought up
+// to date when filter_iirFilter() or filter_getZQueue() next needs them.
+void filter_iirFilterAll(double iirOutputs[]) {
+#ifdef FILTER_FIXED_POINT
+    for (uint16_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++)
+        iirOutputs[channel] = filter_iirFilter(channel);
+    return;
+#endif
+#ifdef FILTER_IIR_BIQUAD
+    float bankOutputs[FILTER_IIR_FILTER_COUNT];
+    biquad_bankFilter(&filterState.iirBank, (float)queue_readElementAtFast(&filterState.yQueue, Y_QUEUE_SIZE - 1),
+                      bankOutputs);
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++) {
+        iirOutputs[channel] = bankOutputs[channel];
+        recordIirOutput(channel, iirOutputs[channel]);
+    }
+    return;
+#endif
+    if (!filterState.iirBankOwnsState)
+        loadIirBankFromZQueues();
+    const queue_data_t *y; // Oldest first, the b coefficients newest first.
+    double z[FILTER_IIR_FILTER_COUNT];
+    queue_window(&filterState.yQueue, Y_QUEUE_SIZE, &y);
+
+    // Same terms in the same order as filter_iirFilter(), one channel per lane.
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++)
+        z[channel] = 0.0;
+    for (uint32_t i = 0; i < Y_QUEUE_SIZE; i++)
+        for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++)
+            z[channel] += y[Y_QUEUE_SIZE - 1 - i] * filterState.iirBankB[i][channel];
+    const double(*window)[FILTER_IIR_FILTER_COUNT] =
+        &filterState.iirBankHistory[filterState.iirBankNewestRow + 1]; // Oldest row first.
+    for (uint32_t i = 0; i < Z_QUEUE_SIZE; i++)
+        for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++)
+            z[channel] -= window[Z_QUEUE_SIZE - 1 - i][channel] * filterState.iirBankA[i][channel];
+
+    filterState.iirBankNewestRow = (filterState.iirBankNewestRow + 1 == Z_QUEUE_SIZE) ? 0 : filterState.iirBankNewestRow + 1;
+    for (uint32_t channel = 0; channel < FILTER_IIR_FILTER_COUNT; channel++) {
+        filterState.iirBankHistory[filterState.iirBankNewestRow][channel] = z[channel];
+        filterState.iirBankHistory[filterState.iirBankNewestRow + Z_QUEUE_SIZE][channel] = z[channel];
+        iirOutputs[channel] = z[channel];
+        recordIirOutput(channel, z[channel]);
+    }
+}
+
+// Returns the sum of squares of all OUTPUT_QUEUE_SIZE values of an
+// outputQueue. The window wraps at the end of the data array at most once, so
+// it is summed as two contiguous spans, oldest first.
+static double sumOfSquaredOutputs(const queue_t *q) {
+    queue_index_t storageSize = q->indexMask + 1;
+    queue_index_t firstSpan = storageSize - q->indexOut;
+    if (firstSpan > OUTPUT_QUEUE_SIZE)
+        firstSpan = OUTPUT_QUEUE_SIZE;
+    const queue_data_t *oldest = &q->data[q->indexOut];
+    double power = 0.0;
+    for (uint32_t i = 0; i < firstSpan; i++)
+        power += oldest[i] * oldest[i];
+    for (uint32_t i = 0; i < OUTPUT_QUEUE_SIZE - firstSpan; i++)
+        power += q->data[i] * q->data[i];
+    return power;
+}
+
 // Use this to compute the power for values contained in an outputQueue.
 // If force == true, then recompute power by using all values in the
 // outputQueue. This option is necessary so that you can correctly compute power
@@ -245,36 +594,89 @@ double filter_iirFilter(uint16_t filterNumber) {
 // 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
 // (newest-value * newest-value). Note that this function will probably need an
 // array to keep track of these values for each of the 10 output queues.
+// The running sums live in powerTracker_t (see powerTracker.h); an incremental
+// call falls back to the full sum every filter_setPowerResyncInterval() calls
+// so that rounding drift stays bounded.
+// With FILTER_POWER_EMA, every call advances the average by the newest IIR
+// output and forceComputeFromScratch is ignored.
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch, bool debugPrint) {
-    double power, oldestVal, newestVal;
-
-    // if: Compute the power using the outputQueue, else: use the previous power value
-    if (forceComputeFromScratch) {
-        power = 0.0;
-        // Compute the power using the outputQueue
-        for (uint32_t i = 0; i < OUTPUT_QUEUE_SIZE; i++)
-            power += pow(queue_readElementAt(&(outputQueue[filterNumber]), i), POW_OF_TWO);
-    
-        currentPowerValue[filterNumber] = power;
+#ifdef FILTER_FIXED_POINT
+    filterState.currentPowerValue[filterNumber] = filterFixed_powerToDouble(
+        filterFixed_computePower(filterNumber, forceComputeFromScratch));
+    return filterState.currentPowerValue[filterNumber];
+#endif
+    if (filterState.powerMode == FILTER_POWER_GOERTZEL)
+        return filterState.currentPowerValue[filterNumber]; // Set by filter_computeAllPowers().
+    if (filterState.powerMode == FILTER_POWER_EMA) {
+        // One-pole average of z^2, scaled to the size of a window sum.
+        double z = filterState.newestIirOutput[filterNumber];
+        filterState.emaPower[filterNumber] += EMA_ALPHA * (z * z - filterState.emaPower[filterNumber]);
+        filterState.currentPowerValue[filterNumber] = OUTPUT_QUEUE_SIZE * filterState.emaPower[filterNumber];
+        return filterState.currentPowerValue[filterNumber];
+    }
+    powerTracker_t *tracker = &filterState.powerTracker[filterNumber];
+    if (forceComputeFromScratch || powerTracker_needsResync(tracker)) {
+        // Exact sum over the whole outputQueue, also resyncs the tracker.
+        double power = sumOfSquaredOutputs(&(filterState.outputQueue[filterNumber]));
+        filterState.currentPowerValue[filterNumber] = powerTracker_resync(tracker, power);
     } else {
-        oldestVal = oldestPowerValue[filterNumber];
-        newestVal = queue_readElementAt(&(outputQueue[filterNumber]), OUTPUT_QUEUE_SIZE-1);
-        currentPowerValue[filterNumber] -= (oldestVal * oldestVal) + (newestVal * newestVal);
+        // O(1): drop the square of the value that was pushed out, add the newest.
+        double oldestVal = filterState.oldestPowerValue[filterNumber];
+        double newestVal = queue_readElementAtFast(&(filterState.outputQueue[filterNumber]), OUTPUT_QUEUE_SIZE-1);
+        filterState.currentPowerValue[filterNumber] = powerTracker_update(tracker, oldestVal, newestVal);
     }
-    oldestPowerValue[filterNumber] = queue_readElementAt(&(outputQueue[filterNumber]), FIRST_INDEX);
-    return power;
+    // This value leaves the window on the next push.
+    filterState.oldestPowerValue[filterNumber] = queue_readElementAtFast(&(filterState.outputQueue[filterNumber]), FIRST_INDEX);
+    if (debugPrint)
+        printf("filter_computePower(%d): %le\n", filterNumber, filterState.currentPowerValue[filterNumber]);
+    return filterState.currentPowerValue[filterNumber];
+}
+
+// Runs the selected power estimator on the newest FIR output (see
+// filter_addFirOutput()) and writes the power of every filter number to
+// powerValues[]. With FILTER_POWER_GOERTZEL this advances the Goertzel bins
+// and skips the IIR filters; otherwise it runs filter_iirFilterAll() and
+// filter_computePower() on every filter number.
+void filter_computeAllPowers(double powerValues[]) {
+#ifndef FILTER_FIXED_POINT
+    if (filterState.powerMode == FILTER_POWER_GOERTZEL) {
+        goertzel_addInput(&filterState.goertzelBank, queue_readElementAtFast(&filterState.yQueue, Y_QUEUE_SIZE - 1));
+        for (uint32_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            // Mean square scaled to the size of an outputQueue sum.
+            filterState.currentPowerValue[i] = OUTPUT_QUEUE_SIZE * goertzel_getPower(&filterState.goertzelBank, i);
+            powerValues[i] = filterState.currentPowerValue[i];
+        }
+        return;
+    }
+#endif
+    double iirOutputs[FILTER_IIR_FILTER_COUNT];
+    filter_iirFilterAll(iirOutputs);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        powerValues[i] = filter_computePower(i, false, false);
+}
+
+// Sets how many incremental filter_computePower() calls may pass before the
+// running sum of a filter is replaced by an exact sum (0 = never).
+void filter_setPowerResyncInterval(uint32_t interval) {
+    for (uint32_t i = 0; i < NUM_OF_PLAYERS; i++)
+        powerTracker_setResyncInterval(&filterState.powerTracker[i], interval);
+}
+
+// Returns the power-tracker statistics (work saved, drift) of a filter number.
+powerTracker_stats_t filter_getPowerStats(uint16_t filterNumber) {
+    return powerTracker_getStats(&filterState.powerTracker[filterNumber]);
 }
 
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber) {
-    return currentPowerValue[filterNumber];
+    return filterState.currentPowerValue[filterNumber];
 }
 
 // Sets a current power value for a specific filter number.
 // Useful in testing the detector.
 void filter_setCurrentPowerValue(uint16_t filterNumber, double value) {
-    currentPowerValue[filterNumber] = value;
+    filterState.currentPowerValue[filterNumber] = value;
 }
 
 // Get a copy of the current power values.
@@ -331,7 +733,7 @@ uint32_t filter_getFirCoefficientCount() {
 
 // Returns the array of coefficients for a particular filter number.
 const double *filter_getIirACoefficientArray(uint16_t filterNumber) {
-    return *iirACoefficientConstants;
+    return iirACoefficientConstants[filterNumber];
 }
 
 // Returns the number of A coefficients.
@@ -341,7 +743,7 @@ uint32_t filter_getIirACoefficientCount() {
 
 // Returns the array of coefficients for a particular filter number.
 const double *filter_getIirBCoefficientArray(uint16_t filterNumber) {
-    return *iirBCoefficientConstants;
+    return iirBCoefficientConstants[filterNumber];
 }
 
 // Returns the number of B coefficients.
@@ -349,6 +751,11 @@ uint32_t filter_getIirBCoefficientCount() {
     return IIR_B_COEFFICIENT_COUNT;
 }
 
+// Returns the FILTER_IIR_SECTION_COUNT biquad sections of a filter number.
+const biquad_section_t *filter_getIirSectionArray(uint16_t filterNumber) {
+    return iirSections[filterNumber];
+}
+
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize() {
     return Y_QUEUE_SIZE;
@@ -359,22 +766,58 @@ uint16_t filter_getDecimationValue() {
     return FILTER_FIR_DECIMATION_FACTOR;
 }
 
-// Returns the address of xQueue.
-queue_t *filter_getXQueue() {
-    return &xQueue;
+// Returns the address of the FIR-filter engine that holds the input history.
+fir_t *filter_getFir() {
+    return &filterState.fir;
 }
 
 // Returns the address of yQueue.
 queue_t *filter_getYQueue() {
-    return &yQueue;
+    return &filterState.yQueue;
 }
 
 // Returns the address of zQueue for a specific filter number.
 queue_t *filter_getZQueue(uint16_t filterNumber) {
-    return &zQueue[filterNumber];
+    syncZQueues(); // The caller may read or overwrite the history.
+    return &filterState.zQueue[filterNumber];
 }
 
 // Returns the address of the IIR output-queue for a specific filter number.
 queue_t *filter_getIirOutputQueue(uint16_t filterNumber) {
-    return &outputQueue[filterNumber];
-}
\ No newline at end of file
+    return &filterState.outputQueue[filterNumber];
+}
+
+// Prints one line of filter_printRamBudget().
+#define PRINT_RAM_BUDGET_LINE(name, bytes)                                     \
+    printf("  %-22s %7u bytes\n", (name), (unsigned)(bytes))
+
+// Prints the size of each part of the filter state and the total. The state
+// is one static block; the filters use no heap memory. The outputQueue storage
+// is reserved whatever the power mode, so FILTER_POWER_EMA and
+// FILTER_POWER_GOERTZEL carry it unused in exchange for switching modes
+// without a heap.
+void filter_printRamBudget() {
+    printf("filter RAM budget (static, %d-byte aligned at %p):\n",
+           FILTER_CACHE_LINE_SIZE, (void *)&filterState);
+    PRINT_RAM_BUDGET_LINE("FIR history", sizeof(filterState.fir));
+    PRINT_RAM_BUDGET_LINE("yQueue storage", sizeof(filterState.yQueueStorage));
+    PRINT_RAM_BUDGET_LINE("zQueue storage", sizeof(filterState.zQueueStorage));
+    PRINT_RAM_BUDGET_LINE("outputQueue storage", sizeof(filterState.outputQueueStorage));
+    if (filterState.powerMode != FILTER_POWER_SLIDING_WINDOW)
+        printf("  (outputQueue storage is unused in this power mode)\n");
+    PRINT_RAM_BUDGET_LINE("queue headers", sizeof(filterState.yQueue) +
+                                               sizeof(filterState.zQueue) +
+                                               sizeof(filterState.outputQueue));
+    PRINT_RAM_BUDGET_LINE("IIR bank", sizeof(filterState.iirBankB) +
+                                          sizeof(filterState.iirBankA) +
+                                          sizeof(filterState.iirBankHistory));
+#ifdef FILTER_IIR_BIQUAD
+    PRINT_RAM_BUDGET_LINE("biquad bank", sizeof(filterState.iirBank));
+#endif
+    PRINT_RAM_BUDGET_LINE("power trackers", sizeof(filterState.powerTracker));
+    PRINT_RAM_BUDGET_LINE("Goertzel bank", sizeof(filterState.goertzelBank));
+    PRINT_RAM_BUDGET_LINE("total (with padding)", sizeof(filterState));
+    PRINT_RAM_BUDGET_LINE("constant tables",
+                          sizeof(firCoefficients) + sizeof(iirACoefficientConstants) +
+                              sizeof(iirBCoefficientConstants) + sizeof(iirSections));
+}
@@ -10,14 +10,37 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifndef FILTER_H_
 #define FILTER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "biquad.h"
+#include "buffer.h"
+#include "fir.h"
+#include "powerTracker.h"
 #include "queue.h"
 
+// Uncomment to run filter_addNewInput(), filter_firFilter(),
+// filter_iirFilter() and filter_computePower() on the Q15/Q31 pipeline in
+// filterFixed.c. Values are converted to double at the API boundary. The
+// double-precision state (FIR history, yQueue, ...) are not updated in this mode,
+// so the queue-based tests in filterTest.c need the double build.
+// #define FILTER_FIXED_POINT
+
+// Uncomment to run filter_iirFilter() as a single-precision cascade of
+// FILTER_IIR_SECTION_COUNT biquads per filter (see biquad.h) instead of the
+// 10th-order direct form. Output and outputQueue behave the same, but the
+// cascade does not read zQueue, so the IIR alignment tests in filterTest.c
+// need the direct-form build.
+// #define FILTER_IIR_BIQUAD
+
 #define FILTER_SAMPLE_FREQUENCY_IN_KHZ 100
 #define FILTER_FREQUENCY_COUNT 10
+#define FILTER_IIR_SECTION_COUNT 5 // Biquads per IIR filter.
 #define FILTER_FIR_DECIMATION_FACTOR                                           \
   10 // FIR-filter needs this many new inputs to compute a new output.
+// Most decimated outputs filter_processBlock() can produce from n samples.
+#define FILTER_BLOCK_MAX_OUTPUT_COUNT(n)                                      \
+  ((n) / FILTER_FIR_DECIMATION_FACTOR + 1)
 #define FILTER_INPUT_PULSE_WIDTH                                               \
   2000 // This is the width of the pulse you are looking for, in terms of
        // decimated sample count.
@@ -36,24 +59,74 @@ static const uint16_t filter_frequencyTickTable[FILTER_FREQUENCY_COUNT] = {
 // 2. The output from the decimating FIR filter is passed through a bank of 10
 // IIR filters. The characteristics of the IIR filter are fixed.
 
+// Power estimators behind filter_computePower().
+typedef enum {
+  // Sum of squares over the last 2000 IIR outputs, kept in the outputQueues.
+  FILTER_POWER_SLIDING_WINDOW,
+  // Leaky integrator (exponential moving average) of the squared IIR outputs
+  // with the mean delay of a 20 ms window, scaled to the size of a 2000-output
+  // sum. Needs no outputQueues, which saves 10 x 2000 doubles (160 KB).
+  FILTER_POWER_EMA,
+  // Sliding Goertzel bins (see goertzel.h) on the FIR output, one per player
+  // frequency, over the same 2000-output window and scaled the same way.
+  // Replaces both the IIR filters and the outputQueues. Only used by
+  // filter_computeAllPowers(); FILTER_FIXED_POINT builds keep the IIR bank.
+  FILTER_POWER_GOERTZEL
+} filter_powerMode_t;
+
 /******************************************************************************
 ***** Main Filter Functions
 ******************************************************************************/
 
 // Must call this prior to using any filter functions.
+// Same as filter_initWithPowerMode(FILTER_POWER_SLIDING_WINDOW).
 void filter_init();
 
-// Use this to copy an input into the input queue of the FIR-filter (xQueue).
+// Initializes the filters with the chosen power estimator. The outputQueues
+// are only filled for FILTER_POWER_SLIDING_WINDOW. All state is static, so
+// calling this again allocates nothing.
+void filter_initWithPowerMode(filter_powerMode_t mode);
+
+// Use this to copy an input into the input history of the FIR-filter.
 void filter_addNewInput(double x);
 
-// Invokes the FIR-filter. Input is contents of xQueue.
+// Invokes the FIR-filter. Input is the FIR input history (see fir.h).
 // Output is returned and is also pushed on to yQueue.
 double filter_firFilter();
 
+// Block version of filter_addNewInput() + filter_firFilter() for raw ADC
+// samples. Scales n ADC values to [-1.0, 1.0], runs the decimating FIR over
+// them and writes only the decimated outputs to firOutputs, which must hold
+// FILTER_BLOCK_MAX_OUTPUT_COUNT(n) values. Returns the number of outputs.
+// The decimation phase carries over between calls (filter_init() resets it),
+// so the block size does not change the outputs. Nothing is pushed onto
+// yQueue; hand each output to filter_addFirOutput() before running the IIR
+// filters on it.
+uint32_t filter_processBlock(const buffer_data_t *adc, size_t n,
+                             double firOutputs[]);
+
+// Pushes a FIR output computed by filter_processBlock() onto yQueue, so that
+// the next filter_iirFilter() calls use it as their newest input.
+void filter_addFirOutput(double y);
+
+// Returns the ADC samples filter_processBlock() has taken since its last
+// decimated output. Output k of the next block comes from its sample
+// FILTER_FIR_DECIMATION_FACTOR - 1 - phase + k * FILTER_FIR_DECIMATION_FACTOR.
+uint32_t filter_getDecimationPhase(void);
+
 // Use this to invoke a single iir filter. Input comes from yQueue.
 // Output is returned and is also pushed onto zQueue[filterNumber].
 double filter_iirFilter(uint16_t filterNumber);
 
+// Runs all FILTER_FREQUENCY_COUNT IIR filters on the newest yQueue value in one
+// pass and writes their outputs to iirOutputs[]. Equivalent to calling
+// filter_iirFilter() for every filter number, with the same outputs, but the
+// coefficients and the filter histories are interleaved by channel, so yQueue
+// is read once and every multiply-accumulate loop runs across the channels.
+// Outputs are pushed onto the outputQueues; the zQueues are only brought up
+// to date when filter_iirFilter() or filter_getZQueue() next needs them.
+void filter_iirFilterAll(double iirOutputs[]);
+
 // Use this to compute the power for values contained in an outputQueue.
 // If force == true, then recompute power by using all values in the
 // outputQueue. This option is necessary so that you can correctly compute power
@@ -67,9 +140,30 @@ double filter_iirFilter(uint16_t filterNumber);
 // 4. Compute new power as: prev-power - (oldest-value * oldest-value) +
 // (newest-value * newest-value). Note that this function will probably need an
 // array to keep track of these values for each of the 10 output queues.
+// The running sums live in powerTracker_t (see powerTracker.h); an incremental
+// call falls back to the full sum every filter_setPowerResyncInterval() calls
+// so that rounding drift stays bounded.
+// With FILTER_POWER_EMA, every call advances the average by the newest IIR
+// output and forceComputeFromScratch is ignored. With FILTER_POWER_GOERTZEL,
+// returns the power from the last filter_computeAllPowers() call.
 double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
                            bool debugPrint);
 
+// Runs the selected power estimator on the newest FIR output (see
+// filter_addFirOutput()) and writes the power of every filter number to
+// powerValues[]. With FILTER_POWER_GOERTZEL this advances the Goertzel bins
+// and skips the IIR filters; otherwise it runs filter_iirFilterAll() and
+// filter_computePower() on every filter number.
+void filter_computeAllPowers(double powerValues[]);
+
+// Sets how many incremental filter_computePower() calls may pass before the
+// running sum of a filter is replaced by an exact sum (0 = never).
+// filter_init() sets it to one window length (OUTPUT_QUEUE_SIZE).
+void filter_setPowerResyncInterval(uint32_t interval);
+
+// Returns the power-tracker statistics (work saved, drift) of a filter number.
+powerTracker_stats_t filter_getPowerStats(uint16_t filterNumber);
+
 // Returns the last-computed output power value for the IIR filter
 // [filterNumber].
 double filter_getCurrentPowerValue(uint16_t filterNumber);
@@ -119,14 +213,17 @@ const double *filter_getIirBCoefficientArray(uint16_t filterNumber);
 // Returns the number of B coefficients.
 uint32_t filter_getIirBCoefficientCount();
 
+// Returns the FILTER_IIR_SECTION_COUNT biquad sections of a filter number.
+const biquad_section_t *filter_getIirSectionArray(uint16_t filterNumber);
+
 // Returns the size of the yQueue.
 uint32_t filter_getYQueueSize();
 
 // Returns the decimation value.
 uint16_t filter_getDecimationValue();
 
-// Returns the address of xQueue.
-queue_t *filter_getXQueue();
+// Returns the address of the FIR-filter engine that holds the input history.
+fir_t *filter_getFir();
 
 // Returns the address of yQueue.
 queue_t *filter_getYQueue();
@@ -135,6 +232,14 @@ queue_t *filter_getYQueue();
 queue_t *filter_getZQueue(uint16_t filterNumber);
 
 // Returns the address of the IIR output-queue for a specific filter-number.
+// Empty unless the power mode is FILTER_POWER_SLIDING_WINDOW.
 queue_t *filter_getIirOutputQueue(uint16_t filterNumber);
 
+// Prints the size of each part of the filter state and the total. The state
+// is one static block; the filters use no heap memory. The outputQueue storage
+// is reserved whatever the power mode, so FILTER_POWER_EMA and
+// FILTER_POWER_GOERTZEL carry it unused in exchange for switching modes
+// without a heap.
+void filter_printRamBudget();
+
 #endif /* FILTER_H_ */
\ No newline at end of file
@@ -0,0 +1,287 @@
+#include "filterFixed.h"
+#include "filter.h"
+#include "fir.h"
+
+// Fixed-point version of the receive pipeline in filter.c.
+// Q15 samples, Q31 accumulators, biquad IIR sections. The 10th-order
+// direct-form IIR filters in filter.c become unstable once their A
+// coefficients are quantized (pole radius goes past 1.0 even at 23 fraction
+// bits), so the fixed-point bank runs each filter as five second-order
+// sections instead. The sections were generated offline with
+// tools/iir2sos.py --format q --fraction-bits 29.
+
+/******************************************************************************
+***** Definitions
+******************************************************************************/
+
+#define FIR_COEFFICIENT_COUNT 81
+#define IIR_SECTION_COUNT 5
+#define IIR_SECTION_COEFFICIENT_COUNT 5
+#define OUTPUT_WINDOW_SIZE 2000
+
+#define SECTION_B0 0
+#define SECTION_B1 1
+#define SECTION_B2 2
+#define SECTION_A1 3
+#define SECTION_A2 4
+
+#define COEFFICIENT_FRACTION_BITS 29
+#define FIR_ACCUMULATOR_FRACTION_BITS (2 * FILTER_FIXED_SAMPLE_FRACTION_BITS)
+#define FIR_TO_SIGNAL_SHIFT                                                    \
+  (FIR_ACCUMULATOR_FRACTION_BITS - FILTER_FIXED_SIGNAL_FRACTION_BITS)
+#define SIGNAL_TO_WINDOW_SHIFT                                                 \
+  (FILTER_FIXED_SIGNAL_FRACTION_BITS - FILTER_FIXED_POWER_FRACTION_BITS / 2)
+
+#define ADC_MIDSCALE 2048
+#define ADC_TO_Q15_SHIFT 4
+#define Q15_MAX INT16_MAX
+#define Q15_MIN INT16_MIN
+
+// Rounds away the low bits of a fixed-point value when shifting right.
+#define ROUNDING_CONSTANT(shift) (1LL << ((shift)-1))
+
+// One second-order section in direct form I.
+typedef struct {
+    filterFixed_signal_t x1, x2; // Previous two section inputs.
+    filterFixed_signal_t y1, y2; // Previous two section outputs.
+} biquadState_t;
+
+// Global Variables
+// Coefficients are reversed to line up with the history window (see fir.h).
+static filterFixed_sample_t
+    firReversedCoefficients[FIR_COEFFICIENT_COUNT] __attribute__((aligned(16)));
+// Mirrored history: each input is stored at xNewestIndex and
+// xNewestIndex + FIR_COEFFICIENT_COUNT.
+static filterFixed_sample_t
+    xHistory[2 * FIR_COEFFICIENT_COUNT] __attribute__((aligned(16)));
+static uint32_t xNewestIndex;
+static filterFixed_signal_t newestFirOutput;
+static biquadState_t iirState[FILTER_FREQUENCY_COUNT][IIR_SECTION_COUNT];
+static int32_t outputWindow[FILTER_FREQUENCY_COUNT][OUTPUT_WINDOW_SIZE];
+static uint32_t outputWindowNewestIndex[FILTER_FREQUENCY_COUNT];
+static int32_t oldestWindowValue[FILTER_FREQUENCY_COUNT];
+static filterFixed_power_t currentPowerValue[FILTER_FREQUENCY_COUNT];
+
+// IIR sections in Q29, {b0, b1, b2, a1, a2} with a0 == 1.
+const static int32_t iirSections[FILTER_FREQUENCY_COUNT][IIR_SECTION_COUNT]
+                                [IIR_SECTION_COEFFICIENT_COUNT] = {
+    {
+        {8304452, 0, -8304452, -636926503, 520264115},
+        {7489080, 0, -7489080, -630889860, 523304298},
+        {9260854, 0, -9260854, -646630712, 523489828},
+        {5026423, 0, -5026423, -630888180, 531626653},
+        {14008792, 0, -14008792, -656440838, 531743039},
+    },
+    {
+        {8303549, 0, -8303549, -495312998, 520264097},
+        {7476932, 0, -7476932, -488058925, 523331914},
+        {9275271, 0, -9275271, -505419304, 523462219},
+        {5004118, 0, -5004118, -486430877, 531643954},
+        {14073719, 0, -14073719, -514674973, 531725739},
+    },
+    {
+        {8303429, 0, -8303429, -326712991, 520264108},
+        {7461386, 0, -7461386, -318329966, 523357136},
+        {9294517, 0, -9294517, -336977348, 523436983},
+        {4990383, 0, -4990383, -314979785, 531659790},
+        {14112777, 0, -14112777, -345358785, 531709899},
+    },
+    {
+        {8304880, 0, -8304880, -150285230, 520264109},
+        {7449622, 0, -7449622, -141024300, 523379413},
+        {9310200, 0, -9310200, -160411558, 523414702},
+        {4976075, 0, -4976075, -136072568, 531673770},
+        {14149354, 0, -14149354, -167677625, 531695917},
+    },
+    {
+        {8304955, 0, -8304955, 87587036, 520264110},
+        {7445343, 0, -7445343, 78081487, 523386843},
+        {9315603, 0, -9315603, 97596942, 523407271},
+        {4971596, 0, -4971596, 72604912, 531678434},
+        {14161894, 0, -14161894, 104422324, 531691254},
+    },
+    {
+        {8303651, 0, -8303651, 289221672, 520264111},
+        {7460592, 0, -7460592, 280627743, 523362110},
+        {9295660, 0, -9295660, 299481033, 523432005},
+        {4985859, 0, -4985859, 276921191, 531662914},
+        {14124972, 0, -14124972, 307641491, 531706774},
+    },
+    {
+        {8305890, 0, -8305890, 528440963, 520264127},
+        {7476614, 0, -7476614, 521447102, 523326141},
+        {9277294, 0, -9277294, 538477729, 523467968},
+        {5010904, 0, -5010904, 520183000, 531640348},
+        {14048231, 0, -14048231, 547879633, 531729341},
+    },
+    {
+        {8303477, 0, -8303477, 658971621, 520264075},
+        {7494721, 0, -7494721, 653151641, 523299119},
+        {9253197, 0, -9253197, 668586180, 523495045},
+        {5023926, 0, -5023926, 653421483, 531623397},
+        {14018442, 0, -14018442, 678464250, 531746301},
+    },
+    {
+        {8303398, 0, -8303398, 791306835, 520264127},
+        {7516876, 0, -7516876, 786988206, 523258339},
+        {9225886, 0, -9225886, 800181933, 523535801},
+        {5048567, 0, -5048567, 789026266, 531597837},
+        {13950209, 0, -13950209, 810329730, 531771858},
+    },
+    {
+        {8303587, 0, -8303587, 915729821, 520264071},
+        {7559769, 0, -7559769, 913287405, 523183626},
+        {9173611, 0, -9173611, 923444276, 523610654},
+        {5093816, 0, -5093816, 917322683, 531551398},
+        {13825864, 0, -13825864, 933511070, 531818282},
+    },
+};
+
+/******************************************************************************
+***** Main Filter Functions
+******************************************************************************/
+
+// Must call this prior to using any filterFixed functions.
+// Converts the FIR coefficients from filter.c and zeroes all history.
+void filterFixed_init(void) {
+    const double *coefficients = filter_getFirCoefficientArray();
+    for (uint32_t i = 0; i < FIR_COEFFICIENT_COUNT; i++)
+        firReversedCoefficients[FIR_COEFFICIENT_COUNT - 1 - i] =
+            filterFixed_fromDouble(coefficients[i]);
+    for (uint32_t i = 0; i < 2 * FIR_COEFFICIENT_COUNT; i++)
+        xHistory[i] = 0;
+    xNewestIndex = 0;
+    newestFirOutput = 0;
+
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+         filterNumber++) {
+        for (uint32_t section = 0; section < IIR_SECTION_COUNT; section++)
+            iirState[filterNumber][section] = (biquadState_t){0, 0, 0, 0};
+        for (uint32_t i = 0; i < OUTPUT_WINDOW_SIZE; i++)
+            outputWindow[filterNumber][i] = 0;
+        outputWindowNewestIndex[filterNumber] = 0;
+        oldestWindowValue[filterNumber] = 0;
+        currentPowerValue[filterNumber] = 0;
+    }
+}
+
+// Converts a value in [-1.0, 1.0) to Q15, saturating out-of-range values.
+filterFixed_sample_t filterFixed_fromDouble(double x) {
+    double scaled = x * (1 << FILTER_FIXED_SAMPLE_FRACTION_BITS);
+    if (scaled >= Q15_MAX)
+        return Q15_MAX;
+    if (scaled <= Q15_MIN)
+        return Q15_MIN;
+    // Round to nearest.
+    return (filterFixed_sample_t)(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+// Converts a raw 12-bit unipolar ADC value to a Q15 sample centered on zero.
+filterFixed_sample_t filterFixed_fromAdc(uint32_t adcValue) {
+    return (filterFixed_sample_t)(((int32_t)adcValue - ADC_MIDSCALE)
+                                  << ADC_TO_Q15_SHIFT);
+}
+
+// Converts a double to Q27, rounding to nearest. The caller keeps |z| < 16.
+filterFixed_signal_t filterFixed_signalFromDouble(double z) {
+    double scaled = z * (1 << FILTER_FIXED_SIGNAL_FRACTION_BITS);
+    return (filterFixed_signal_t)(scaled < 0.0 ? scaled - 0.5 : scaled + 0.5);
+}
+
+// Converts the fixed-point types back to double.
+double filterFixed_sampleToDouble(filterFixed_sample_t x) {
+    return (double)x / (1 << FILTER_FIXED_SAMPLE_FRACTION_BITS);
+}
+
+double filterFixed_signalToDouble(filterFixed_signal_t z) {
+    return (double)z / (1 << FILTER_FIXED_SIGNAL_FRACTION_BITS);
+}
+
+double filterFixed_powerToDouble(filterFixed_power_t power) {
+    return (double)power / (double)(1LL << FILTER_FIXED_POWER_FRACTION_BITS);
+}
+
+// Copies an input into the FIR input history.
+void filterFixed_addNewInput(filterFixed_sample_t x) {
+    xNewestIndex = (xNewestIndex + 1 == FIR_COEFFICIENT_COUNT) ? 0 : xNewestIndex + 1;
+    xHistory[xNewestIndex] = x;
+    xHistory[xNewestIndex + FIR_COEFFICIENT_COUNT] = x;
+}
+
+// Invokes the FIR-filter over the input history.
+// Output is returned and becomes the input of the IIR bank.
+filterFixed_signal_t filterFixed_firFilter(void) {
+    // Q15 * Q15 products accumulate as Q30. The sum of the absolute FIR
+    // coefficients is below 2.0, so a 32-bit accumulator cannot overflow.
+    int32_t accumulator =
+        fir_dotProductQ15(&xHistory[xNewestIndex + 1], firReversedCoefficients,
+                          FIR_COEFFICIENT_COUNT);
+    newestFirOutput =
+        (accumulator + (int32_t)ROUNDING_CONSTANT(FIR_TO_SIGNAL_SHIFT)) >>
+        FIR_TO_SIGNAL_SHIFT;
+    return newestFirOutput;
+}
+
+// Replaces the newest FIR output, the input of the IIR bank. Used when the
+// FIR outputs were computed elsewhere, e.g. by filter_processBlock().
+void filterFixed_addFirOutput(filterFixed_signal_t y) {
+    newestFirOutput = y;
+}
+
+// Runs the biquad cascade for filterNumber on the newest FIR output.
+// Output is returned and is also pushed into that filter's power window.
+filterFixed_signal_t filterFixed_iirFilter(uint16_t filterNumber) {
+    filterFixed_signal_t x = newestFirOutput;
+
+    for (uint32_t section = 0; section < IIR_SECTION_COUNT; section++) {
+        const int32_t *c = iirSections[filterNumber][section];
+        biquadState_t *s = &iirState[filterNumber][section];
+        // Q27 * Q29 products accumulate as Q56 in 64 bits.
+        int64_t accumulator = (int64_t)c[SECTION_B0] * x +
+                              (int64_t)c[SECTION_B1] * s->x1 +
+                              (int64_t)c[SECTION_B2] * s->x2 -
+                              (int64_t)c[SECTION_A1] * s->y1 -
+                              (int64_t)c[SECTION_A2] * s->y2;
+        filterFixed_signal_t y = (filterFixed_signal_t)(
+            (accumulator + ROUNDING_CONSTANT(COEFFICIENT_FRACTION_BITS)) >>
+            COEFFICIENT_FRACTION_BITS);
+        s->x2 = s->x1;
+        s->x1 = x;
+        s->y2 = s->y1;
+        s->y1 = y;
+        x = y; // Output of this section feeds the next one.
+    }
+
+    // Keep a reduced-precision copy for the power computation so that a
+    // window of squares fits comfortably in 64 bits.
+    uint32_t *newest = &outputWindowNewestIndex[filterNumber];
+    *newest = (*newest + 1 == OUTPUT_WINDOW_SIZE) ? 0 : *newest + 1;
+    oldestWindowValue[filterNumber] = outputWindow[filterNumber][*newest];
+    outputWindow[filterNumber][*newest] = x >> SIGNAL_TO_WINDOW_SHIFT;
+    return x;
+}
+
+// Computes the power over the output window of filterNumber. If
+// forceComputeFromScratch is false, the previous power is updated
+// incrementally with the oldest and newest window values.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch) {
+    const int32_t *window = outputWindow[filterNumber];
+    if (forceComputeFromScratch) {
+        filterFixed_power_t power = 0;
+        for (uint32_t i = 0; i < OUTPUT_WINDOW_SIZE; i++)
+            power += (int64_t)window[i] * window[i];
+        currentPowerValue[filterNumber] = power;
+    } else {
+        // Integer arithmetic is exact, so the running sum never drifts.
+        int64_t oldest = oldestWindowValue[filterNumber];
+        int64_t newest = window[outputWindowNewestIndex[filterNumber]];
+        currentPowerValue[filterNumber] += newest * newest - oldest * oldest;
+    }
+    return currentPowerValue[filterNumber];
+}
+
+// Returns the last-computed power value for filterNumber.
+filterFixed_power_t filterFixed_getCurrentPowerValue(uint16_t filterNumber) {
+    return currentPowerValue[filterNumber];
+}
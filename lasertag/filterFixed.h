@@ -0,0 +1,80 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FILTERFIXED_H_
+#define FILTERFIXED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Fixed-point version of the receive pipeline in filter.c.
+// Input samples are Q15 (int16_t). The FIR accumulates Q30 products in a
+// 32-bit accumulator and hands a Q27 result to the IIR bank: a square wave
+// overshoots 1.0 after the lowpass, so the filtered signals keep four integer
+// bits of headroom. The IIR bank runs as five biquads per player frequency
+// with Q29 coefficients and 64-bit accumulators. Power is a Q38 sum of
+// squares.
+// Define FILTER_FIXED_POINT in filter.h to route the filter_ API through here.
+
+#define FILTER_FIXED_SAMPLE_FRACTION_BITS 15
+#define FILTER_FIXED_SIGNAL_FRACTION_BITS 27
+#define FILTER_FIXED_POWER_FRACTION_BITS 38
+
+// Q15 input sample.
+typedef int16_t filterFixed_sample_t;
+
+// Q27 FIR and IIR output.
+typedef int32_t filterFixed_signal_t;
+
+// Q38 power (sum of squares over the output window).
+typedef int64_t filterFixed_power_t;
+
+// Must call this prior to using any filterFixed functions.
+// Converts the FIR coefficients from filter.c and zeroes all history.
+void filterFixed_init(void);
+
+// Converts a value in [-1.0, 1.0) to Q15, saturating out-of-range values.
+filterFixed_sample_t filterFixed_fromDouble(double x);
+
+// Converts a raw 12-bit unipolar ADC value to a Q15 sample centered on zero.
+filterFixed_sample_t filterFixed_fromAdc(uint32_t adcValue);
+
+// Converts a double to Q27, rounding to nearest. The caller keeps |z| < 16.
+filterFixed_signal_t filterFixed_signalFromDouble(double z);
+
+// Converts the fixed-point types back to double.
+double filterFixed_sampleToDouble(filterFixed_sample_t x);
+double filterFixed_signalToDouble(filterFixed_signal_t z);
+double filterFixed_powerToDouble(filterFixed_power_t power);
+
+// Copies an input into the FIR input history.
+void filterFixed_addNewInput(filterFixed_sample_t x);
+
+// Invokes the FIR-filter over the input history.
+// Output is returned and becomes the input of the IIR bank.
+filterFixed_signal_t filterFixed_firFilter(void);
+
+// Replaces the newest FIR output, the input of the IIR bank. Used when the
+// FIR outputs were computed elsewhere, e.g. by filter_processBlock().
+void filterFixed_addFirOutput(filterFixed_signal_t y);
+
+// Runs the biquad cascade for filterNumber on the newest FIR output.
+// Output is returned and is also pushed into that filter's power window.
+filterFixed_signal_t filterFixed_iirFilter(uint16_t filterNumber);
+
+// Computes the power over the output window of filterNumber. If
+// forceComputeFromScratch is false, the previous power is updated
+// incrementally with the oldest and newest window values.
+filterFixed_power_t filterFixed_computePower(uint16_t filterNumber,
+                                             bool forceComputeFromScratch);
+
+// Returns the last-computed power value for filterNumber.
+filterFixed_power_t filterFixed_getCurrentPowerValue(uint16_t filterNumber);
+
+#endif /* FILTERFIXED_H_ */
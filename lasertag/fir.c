@@ -0,0 +1,243 @@
+#include "fir.h"
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// FIR-filter engine with a mirrored (double-length) linear history.
+
+/******************************************************************************
+***** Definitions
+******************************************************************************/
+
+#define DOUBLES_PER_VECTOR 2
+#define Q15_PER_NEON_VECTOR 8
+#define Q15_PER_HOST_VECTOR 4
+
+#if !defined(__ARM_NEON) && defined(__GNUC__)
+#define FIR_USE_VECTOR_EXTENSIONS
+typedef double fir_v2df_t __attribute__((vector_size(16)));
+typedef int16_t fir_v4hi_t __attribute__((vector_size(8)));
+typedef int32_t fir_v4si_t __attribute__((vector_size(16)));
+typedef int64_t fir_v2di_t __attribute__((vector_size(16)));
+#if defined(__clang__)
+#define FIR_SWAP_LANES(v) __builtin_shufflevector((v), (v), 1, 0)
+#else
+#define FIR_SWAP_LANES(v) __builtin_shuffle((v), (fir_v2di_t){1, 0})
+#endif
+#endif
+
+/******************************************************************************
+***** Engine Functions
+******************************************************************************/
+
+// Returns true if coefficients[i] == coefficients[tapCount - 1 - i] for all i.
+// The comparison is exact: a folded filter must compute the same filter.
+static bool coefficientsAreSymmetric(const double coefficients[],
+                                     uint32_t tapCount) {
+    for (uint32_t i = 0; i < tapCount / 2; i++)
+        if (coefficients[i] != coefficients[tapCount - 1 - i])
+            return false;
+    return true;
+}
+
+// Loads the coefficients (b[0] multiplies the newest input), detects whether
+// they are symmetric and fills the history with zeros. tapCount must not
+// exceed FIR_MAX_TAP_COUNT.
+void fir_init(fir_t *f, const double coefficients[], uint32_t tapCount) {
+    f->tapCount = tapCount;
+    for (uint32_t i = 0; i < tapCount; i++)
+        f->reversedCoefficients[i] = coefficients[tapCount - 1 - i];
+    f->symmetric = coefficientsAreSymmetric(coefficients, tapCount);
+    fir_fill(f, 0.0);
+}
+
+// Returns true if fir_init() found symmetric coefficients.
+bool fir_isSymmetric(const fir_t *f) {
+    return f->symmetric;
+}
+
+// Overwrites the entire history with value.
+void fir_fill(fir_t *f, double value) {
+    for (uint32_t i = 0; i < 2 * f->tapCount; i++)
+        f->history[i] = value;
+    f->newestIndex = 0;
+}
+
+// Adds a new input, discarding the oldest one.
+void fir_addNewInput(fir_t *f, double x) {
+    f->newestIndex = (f->newestIndex + 1 == f->tapCount) ? 0 : f->newestIndex + 1;
+    f->history[f->newestIndex] = x;
+    f->history[f->newestIndex + f->tapCount] = x;
+}
+
+// Returns the newest tapCount inputs, oldest first, as a contiguous array.
+const double *fir_window(const fir_t *f) {
+    return &f->history[f->newestIndex + 1];
+}
+
+// Runs the kernel selected by fir_init() over any window of tapCount inputs.
+static double computeWindow(const fir_t *f, const double window[]) {
+    if (f->symmetric)
+        return fir_foldedDotProduct(window, f->reversedCoefficients, f->tapCount);
+    return fir_dotProduct(window, f->reversedCoefficients, f->tapCount);
+}
+
+// Computes the filter output for the current history. Uses the folded kernel
+// for symmetric coefficients.
+double fir_compute(const fir_t *f) {
+    return computeWindow(f, fir_window(f));
+}
+
+// Decimating block FIR. Consumes inputCount inputs and writes one output for
+// every factor-th input to outputs[], returning the number written. *phase
+// counts the inputs seen since the last output and carries over between
+// calls, so blocks of any size produce the same outputs as fir_addNewInput()
+// followed by fir_compute() on every factor-th input. Only the kept outputs
+// are computed, over a contiguous window of the old history followed by the
+// block, so inputs are copied once and the history is rewritten once per
+// chunk instead of twice per input.
+uint32_t fir_decimate(fir_t *f, const double inputs[], uint32_t inputCount,
+                      uint32_t factor, uint32_t *phase, double outputs[]) {
+    double scratch[FIR_MAX_TAP_COUNT + FIR_DECIMATE_CHUNK_SIZE];
+    uint32_t tapCount = f->tapCount;
+    uint32_t outputCount = 0;
+    while (inputCount > 0) {
+        uint32_t chunk = inputCount < FIR_DECIMATE_CHUNK_SIZE
+                             ? inputCount
+                             : FIR_DECIMATE_CHUNK_SIZE;
+        // scratch[j + 1] starts the window whose newest input is inputs[j].
+        memcpy(scratch, fir_window(f), tapCount * sizeof(double));
+        memcpy(&scratch[tapCount], inputs, chunk * sizeof(double));
+        // The first kept input is the one that completes the current phase.
+        for (uint32_t j = factor - 1 - *phase; j < chunk; j += factor)
+            outputs[outputCount++] = computeWindow(f, &scratch[j + 1]);
+        *phase = (*phase + chunk) % factor;
+        // The newest tapCount inputs become the history, written to both
+        // halves with the newest at the end of the first half.
+        memcpy(f->history, &scratch[chunk], tapCount * sizeof(double));
+        memcpy(&f->history[tapCount], &scratch[chunk], tapCount * sizeof(double));
+        f->newestIndex = tapCount - 1;
+        inputs += chunk;
+        inputCount -= chunk;
+    }
+    return outputCount;
+}
+
+/******************************************************************************
+***** Kernels
+******************************************************************************/
+
+// Returns the sum of a[i] * b[i]. Uses GCC vector extensions when available.
+// ARMv7 NEON has no double-precision lanes, so the A9 build runs an unrolled
+// VFP loop instead.
+double fir_dotProduct(const double a[], const double b[], uint32_t count) {
+    uint32_t i = 0;
+    double sum;
+#ifdef FIR_USE_VECTOR_EXTENSIONS
+    fir_v2df_t sum0 = {0.0, 0.0};
+    fir_v2df_t sum1 = {0.0, 0.0};
+    // Two independent accumulators hide the latency of the adds.
+    for (; i + 2 * DOUBLES_PER_VECTOR <= count; i += 2 * DOUBLES_PER_VECTOR) {
+        fir_v2df_t a0, a1, b0, b1;
+        memcpy(&a0, &a[i], sizeof(a0)); // The window is not 16-byte aligned.
+        memcpy(&a1, &a[i + DOUBLES_PER_VECTOR], sizeof(a1));
+        memcpy(&b0, &b[i], sizeof(b0));
+        memcpy(&b1, &b[i + DOUBLES_PER_VECTOR], sizeof(b1));
+        sum0 += a0 * b0;
+        sum1 += a1 * b1;
+    }
+    sum0 += sum1;
+    sum = sum0[0] + sum0[1];
+#else
+    double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0, sum3 = 0.0;
+    for (; i + 4 <= count; i += 4) {
+        sum0 += a[i] * b[i];
+        sum1 += a[i + 1] * b[i + 1];
+        sum2 += a[i + 2] * b[i + 2];
+        sum3 += a[i + 3] * b[i + 3];
+    }
+    sum = (sum0 + sum1) + (sum2 + sum3);
+#endif
+    for (; i < count; i++)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+// Returns the dot product of window[] with symmetric coefficients[], adding
+// window[i] and window[count - 1 - i] before multiplying. Only the first
+// (count + 1) / 2 coefficients are read. The sum is grouped differently from
+// fir_dotProduct(), so results can differ in the last few bits.
+double fir_foldedDotProduct(const double window[], const double coefficients[],
+                            uint32_t count) {
+    uint32_t pairCount = count / 2;
+    const double *mirror = &window[count - 1]; // mirror[-i] pairs with window[i].
+    uint32_t i = 0;
+    double sum;
+#ifdef FIR_USE_VECTOR_EXTENSIONS
+    fir_v2df_t sum0 = {0.0, 0.0};
+    fir_v2df_t sum1 = {0.0, 0.0};
+    for (; i + 2 * DOUBLES_PER_VECTOR <= pairCount; i += 2 * DOUBLES_PER_VECTOR) {
+        fir_v2df_t front0, front1, back0, back1, c0, c1;
+        memcpy(&front0, &window[i], sizeof(front0));
+        memcpy(&front1, &window[i + DOUBLES_PER_VECTOR], sizeof(front1));
+        memcpy(&back0, &mirror[-(int32_t)i - 1], sizeof(back0));
+        memcpy(&back1, &mirror[-(int32_t)i - 3], sizeof(back1));
+        memcpy(&c0, &coefficients[i], sizeof(c0));
+        memcpy(&c1, &coefficients[i + DOUBLES_PER_VECTOR], sizeof(c1));
+        // Mirrored inputs run backwards, so swap the two lanes of each pair.
+        sum0 += c0 * (front0 + FIR_SWAP_LANES(back0));
+        sum1 += c1 * (front1 + FIR_SWAP_LANES(back1));
+    }
+    sum0 += sum1;
+    sum = sum0[0] + sum0[1];
+#else
+    double sum0 = 0.0, sum1 = 0.0;
+    for (; i + 2 <= pairCount; i += 2) {
+        sum0 += coefficients[i] * (window[i] + mirror[-(int32_t)i]);
+        sum1 += coefficients[i + 1] * (window[i + 1] + mirror[-(int32_t)i - 1]);
+    }
+    sum = sum0 + sum1;
+#endif
+    for (; i < pairCount; i++)
+        sum += coefficients[i] * (window[i] + mirror[-(int32_t)i]);
+    // Odd tap counts have an unpaired center tap.
+    if (count & 1)
+        sum += coefficients[pairCount] * window[pairCount];
+    return sum;
+}
+
+// Returns the sum of a[i] * b[i] for Q15 data as a Q30 value. Uses NEON
+// (vmlal_s16) on the A9 and GCC vector extensions on the host. The caller
+// must make sure the sum fits in 32 bits.
+int32_t fir_dotProductQ15(const int16_t a[], const int16_t b[], uint32_t count) {
+    uint32_t i = 0;
+    int32_t sum;
+#if defined(__ARM_NEON)
+    int32x4_t accumulator = vdupq_n_s32(0);
+    for (; i + Q15_PER_NEON_VECTOR <= count; i += Q15_PER_NEON_VECTOR) {
+        int16x8_t va = vld1q_s16(&a[i]);
+        int16x8_t vb = vld1q_s16(&b[i]);
+        accumulator = vmlal_s16(accumulator, vget_low_s16(va), vget_low_s16(vb));
+        accumulator = vmlal_s16(accumulator, vget_high_s16(va), vget_high_s16(vb));
+    }
+    int32x2_t pair = vadd_s32(vget_low_s32(accumulator), vget_high_s32(accumulator));
+    sum = vget_lane_s32(vpadd_s32(pair, pair), 0);
+#elif defined(FIR_USE_VECTOR_EXTENSIONS)
+    fir_v4si_t accumulator = {0, 0, 0, 0};
+    for (; i + Q15_PER_HOST_VECTOR <= count; i += Q15_PER_HOST_VECTOR) {
+        fir_v4hi_t va, vb;
+        memcpy(&va, &a[i], sizeof(va));
+        memcpy(&vb, &b[i], sizeof(vb));
+        accumulator += __builtin_convertvector(va, fir_v4si_t) *
+                       __builtin_convertvector(vb, fir_v4si_t);
+    }
+    sum = accumulator[0] + accumulator[1] + accumulator[2] + accumulator[3];
+#else
+    sum = 0;
+#endif
+    for (; i < count; i++)
+        sum += (int32_t)a[i] * b[i];
+    return sum;
+}
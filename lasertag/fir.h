@@ -0,0 +1,91 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef FIR_H_
+#define FIR_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// FIR-filter engine with a mirrored (double-length) linear history.
+// Every input is written twice, tapCount elements apart, so the newest
+// tapCount inputs always sit in contiguous memory, oldest first. The dot
+// product then runs over two plain arrays with no index wrapping, which lets
+// fir_dotProduct() use SIMD.
+// Linear-phase filters (b[i] == b[tapCount - 1 - i]) are detected when the
+// coefficients are loaded and run folded: mirrored inputs are added first, so
+// an 81-tap filter costs 41 multiplies instead of 81.
+
+#define FIR_MAX_TAP_COUNT 128
+// fir_decimate() works through its input in chunks of this many samples.
+#define FIR_DECIMATE_CHUNK_SIZE 128
+
+typedef struct {
+  // Coefficients in reverse order so they line up with the history window.
+  double reversedCoefficients[FIR_MAX_TAP_COUNT] __attribute__((aligned(16)));
+  // Each input is stored at newestIndex and newestIndex + tapCount.
+  double history[2 * FIR_MAX_TAP_COUNT] __attribute__((aligned(16)));
+  // Number of taps in use.
+  uint32_t tapCount;
+  // Position of the newest input in the first half of history.
+  uint32_t newestIndex;
+  // True if the coefficients are symmetric, selects the folded kernel.
+  bool symmetric;
+} fir_t;
+
+// Loads the coefficients (b[0] multiplies the newest input), detects whether
+// they are symmetric and fills the history with zeros. tapCount must not
+// exceed FIR_MAX_TAP_COUNT.
+void fir_init(fir_t *f, const double coefficients[], uint32_t tapCount);
+
+// Returns true if fir_init() found symmetric coefficients.
+bool fir_isSymmetric(const fir_t *f);
+
+// Overwrites the entire history with value.
+void fir_fill(fir_t *f, double value);
+
+// Adds a new input, discarding the oldest one.
+void fir_addNewInput(fir_t *f, double x);
+
+// Returns the newest tapCount inputs, oldest first, as a contiguous array.
+const double *fir_window(const fir_t *f);
+
+// Computes the filter output for the current history. Uses the folded kernel
+// for symmetric coefficients.
+double fir_compute(const fir_t *f);
+
+// Decimating block FIR. Consumes inputCount inputs and writes one output for
+// every factor-th input to outputs[], returning the number written. *phase
+// counts the inputs seen since the last output and carries over between
+// calls, so blocks of any size produce the same outputs as fir_addNewInput()
+// followed by fir_compute() on every factor-th input. Only the kept outputs
+// are computed, over a contiguous window of the old history followed by the
+// block, so inputs are copied once and the history is rewritten once per
+// chunk instead of twice per input.
+uint32_t fir_decimate(fir_t *f, const double inputs[], uint32_t inputCount,
+                      uint32_t factor, uint32_t *phase, double outputs[]);
+
+// Returns the sum of a[i] * b[i]. Uses GCC vector extensions when available.
+// ARMv7 NEON has no double-precision lanes, so the A9 build runs an unrolled
+// VFP loop instead.
+double fir_dotProduct(const double a[], const double b[], uint32_t count);
+
+// Returns the dot product of window[] with symmetric coefficients[], adding
+// window[i] and window[count - 1 - i] before multiplying. Only the first
+// (count + 1) / 2 coefficients are read. The sum is grouped differently from
+// fir_dotProduct(), so results can differ in the last few bits.
+double fir_foldedDotProduct(const double window[], const double coefficients[],
+                            uint32_t count);
+
+// Returns the sum of a[i] * b[i] for Q15 data as a Q30 value. Uses NEON
+// (vmlal_s16) on the A9 and GCC vector extensions on the host. The caller
+// must make sure the sum fits in 32 bits.
+int32_t fir_dotProductQ15(const int16_t a[], const int16_t b[], uint32_t count);
+
+#endif /* FIR_H_ */
@@ -0,0 +1,116 @@
+#include "goertzel.h"
+#include <math.h>
+
+// Bank of sliding Goertzel bins over a shared input history.
+
+#define GOERTZEL_PI 3.14159265358979323846
+
+// Returns the greatest common divisor of a and b.
+static uint32_t greatestCommonDivisor(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t remainder = a % b;
+        a = b;
+        b = remainder;
+    }
+    return a;
+}
+
+// Returns the history index of x[n - age], where x[n] is the newest input.
+static uint32_t historyIndex(const goertzel_bank_t *g, uint32_t age) {
+    return (g->newestIndex >= age) ? g->newestIndex - age
+                                   : g->newestIndex + g->historySize - age;
+}
+
+// Tunes bin i to decimationFactor / periods[i] cycles per input, i.e. to a
+// tone with a period of periods[i] samples before decimation by
+// decimationFactor. Each window is the largest whole number of periods that
+// fits in maxWindowSize inputs (at most GOERTZEL_MAX_WINDOW_SIZE). binCount
+// must not exceed GOERTZEL_MAX_BIN_COUNT. A resyncInterval of 0 disables
+// resyncing. Starts with an all-zero history.
+void goertzel_init(goertzel_bank_t *g, const uint16_t periods[],
+                   uint32_t binCount, uint32_t decimationFactor,
+                   uint32_t maxWindowSize, uint32_t resyncInterval) {
+    if (maxWindowSize > GOERTZEL_MAX_WINDOW_SIZE)
+        maxWindowSize = GOERTZEL_MAX_WINDOW_SIZE;
+    g->binCount = binCount;
+    g->historySize = 0;
+    for (uint32_t bin = 0; bin < binCount; bin++) {
+        // The shortest run of inputs that holds a whole number of cycles.
+        uint32_t cycleLength =
+            periods[bin] / greatestCommonDivisor(periods[bin], decimationFactor);
+        g->windowSize[bin] = (maxWindowSize / cycleLength) * cycleLength;
+        g->coefficient[bin] =
+            2.0 * cos(2.0 * GOERTZEL_PI * decimationFactor / periods[bin]);
+        if (g->windowSize[bin] + 1 > g->historySize)
+            g->historySize = g->windowSize[bin] + 1;
+    }
+    g->resyncInterval = resyncInterval;
+    goertzel_reset(g);
+}
+
+// Zeroes the history and the bin states.
+void goertzel_reset(goertzel_bank_t *g) {
+    for (uint32_t i = 0; i < g->historySize; i++)
+        g->history[i] = 0.0;
+    for (uint32_t bin = 0; bin < g->binCount; bin++) {
+        g->s1[bin] = 0.0;
+        g->s2[bin] = 0.0;
+    }
+    g->newestIndex = 0;
+    g->updatesSinceResync = 0;
+}
+
+// Adds a new input and advances every bin by one step.
+void goertzel_addInput(goertzel_bank_t *g, double x) {
+    // The slot of x[n - historySize] is reused; no window reaches that far.
+    g->newestIndex = (g->newestIndex + 1 == g->historySize) ? 0 : g->newestIndex + 1;
+    g->history[g->newestIndex] = x;
+    for (uint32_t bin = 0; bin < g->binCount; bin++) {
+        double leaving = g->history[historyIndex(g, g->windowSize[bin])];
+        double s = (x - leaving) + g->coefficient[bin] * g->s1[bin] - g->s2[bin];
+        g->s2[bin] = g->s1[bin];
+        g->s1[bin] = s;
+    }
+    if (g->resyncInterval != 0 && ++g->updatesSinceResync >= g->resyncInterval)
+        goertzel_resync(g);
+}
+
+// Recomputes the bin states from the history, removing accumulated rounding
+// error. goertzel_addInput() calls this every resyncInterval inputs.
+void goertzel_resync(goertzel_bank_t *g) {
+    for (uint32_t bin = 0; bin < g->binCount; bin++) {
+        uint32_t windowSize = g->windowSize[bin];
+        double coefficient = g->coefficient[bin];
+        // A plain Goertzel run over x[n - windowSize] .. x[n - 1] gives s[n - 1]
+        // in current and, one input earlier, s[n - 2] in previous: the input
+        // that left s[n - 2]'s window has a zero weight there.
+        uint32_t index = historyIndex(g, windowSize);
+        double current = 0.0, previous = 0.0;
+        for (uint32_t k = 0; k < windowSize; k++) {
+            double s = g->history[index] + coefficient * current - previous;
+            previous = current;
+            current = s;
+            index = (index + 1 == g->historySize) ? 0 : index + 1;
+        }
+        // One sliding step brings in x[n].
+        g->s2[bin] = current;
+        g->s1[bin] = (g->history[g->newestIndex] -
+                      g->history[historyIndex(g, windowSize)]) +
+                     coefficient * current - previous;
+    }
+    g->updatesSinceResync = 0;
+}
+
+// Returns the mean-square power of bin's frequency over its window,
+// 2 |X|^2 / windowSize^2: A^2 / 2 for a sinusoid of amplitude A.
+double goertzel_getPower(const goertzel_bank_t *g, uint32_t bin) {
+    double s1 = g->s1[bin], s2 = g->s2[bin];
+    double magnitudeSquared = s1 * s1 + s2 * s2 - g->coefficient[bin] * s1 * s2;
+    double windowSize = g->windowSize[bin];
+    return 2.0 * magnitudeSquared / (windowSize * windowSize);
+}
+
+// Returns the number of inputs in bin's window.
+uint32_t goertzel_getWindowSize(const goertzel_bank_t *g, uint32_t bin) {
+    return g->windowSize[bin];
+}
@@ -0,0 +1,72 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef GOERTZEL_H_
+#define GOERTZEL_H_
+
+#include <stdint.h>
+
+// Bank of sliding Goertzel bins: one DFT bin per known frequency, updated
+// for every input over a sliding window of the newest windowSize inputs.
+// Each bin runs the recurrence
+//   s[n] = x[n] - x[n - windowSize] + 2 cos(w) s[n - 1] - s[n - 2],
+// one multiply per input, and its power is read out on demand with three
+// more multiplies. windowSize is picked per bin so that the window holds a
+// whole number of periods; then the comb (x[n] - x[n - windowSize]) cancels
+// the resonator's response to inputs that left the window exactly, and s[n]
+// equals a plain Goertzel run over the window. The resonator sits on the unit
+// circle, so rounding errors never decay: every resyncInterval inputs the
+// states are recomputed from the input history.
+
+#define GOERTZEL_MAX_BIN_COUNT 10
+#define GOERTZEL_MAX_WINDOW_SIZE 2000
+
+typedef struct {
+  // Per-bin values, indexed by bin so the update loop runs across bins.
+  double coefficient[GOERTZEL_MAX_BIN_COUNT]; // 2 cos(w).
+  double s1[GOERTZEL_MAX_BIN_COUNT];          // s[n].
+  double s2[GOERTZEL_MAX_BIN_COUNT];          // s[n - 1].
+  uint32_t windowSize[GOERTZEL_MAX_BIN_COUNT];
+  uint32_t binCount;
+  // Ring of the newest inputs, long enough to reach x[n - windowSize].
+  double history[GOERTZEL_MAX_WINDOW_SIZE + 1];
+  uint32_t historySize;
+  uint32_t newestIndex;
+  uint32_t resyncInterval;     // Inputs between resyncs, 0 = never.
+  uint32_t updatesSinceResync; // Inputs since the last resync.
+} goertzel_bank_t;
+
+// Tunes bin i to decimationFactor / periods[i] cycles per input, i.e. to a
+// tone with a period of periods[i] samples before decimation by
+// decimationFactor. Each window is the largest whole number of periods that
+// fits in maxWindowSize inputs (at most GOERTZEL_MAX_WINDOW_SIZE). binCount
+// must not exceed GOERTZEL_MAX_BIN_COUNT. A resyncInterval of 0 disables
+// resyncing. Starts with an all-zero history.
+void goertzel_init(goertzel_bank_t *g, const uint16_t periods[],
+                   uint32_t binCount, uint32_t decimationFactor,
+                   uint32_t maxWindowSize, uint32_t resyncInterval);
+
+// Zeroes the history and the bin states.
+void goertzel_reset(goertzel_bank_t *g);
+
+// Adds a new input and advances every bin by one step.
+void goertzel_addInput(goertzel_bank_t *g, double x);
+
+// Recomputes the bin states from the history, removing accumulated rounding
+// error. goertzel_addInput() calls this every resyncInterval inputs.
+void goertzel_resync(goertzel_bank_t *g);
+
+// Returns the mean-square power of bin's frequency over its window,
+// 2 |X|^2 / windowSize^2: A^2 / 2 for a sinusoid of amplitude A.
+double goertzel_getPower(const goertzel_bank_t *g, uint32_t bin);
+
+// Returns the number of inputs in bin's window.
+uint32_t goertzel_getWindowSize(const goertzel_bank_t *g, uint32_t bin);
+
+#endif /* GOERTZEL_H_ */
@@ -4,6 +4,7 @@
 #include "transmitter.h"
 #include "lockoutTimer.h"
 #include "buffer.h"
+#include "adcCapture.h"
 
 // Perform initialization for interrupt and timing related modules.
 void isr_init() {
@@ -12,6 +13,7 @@ void isr_init() {
     hitLedTimer_init();
     lockoutTimer_init();
     buffer_init();
+    adcCapture_init();
 }
 
 // This function is invoked by the timer interrupt at 100 kHz.
@@ -21,5 +23,9 @@ void isr_function() {
     hitLedTimer_tick();
     transmitter_tick();
     lockoutTimer_tick();
+#ifdef ISR_BLOCK_CAPTURE
+    adcCapture_tick(interrupts_getAdcData());
+#else
     buffer_pushover(interrupts_getAdcData());
+#endif
 }
\ No newline at end of file
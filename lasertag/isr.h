@@ -14,6 +14,11 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Add function calls for state machine tick functions and
 // other interrupt related modules.
 
+// Uncomment to hand ADC samples to the main loop in blocks (see adcCapture.h)
+// instead of one buffer_pushover() per tick. Call detector_runBlocks() instead
+// of detector() in this mode.
+// #define ISR_BLOCK_CAPTURE
+
 // Perform initialization for interrupt and timing related modules.
 void isr_init();
 
@@ -35,6 +35,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include "leds.h"
 #include "lockoutTimer.h"
 #include "mio.h"
+#include "powerRankTest.h"
 #include "queueTest.h"
 #include "runningModes.h"
 #include "sound.h"
@@ -57,7 +58,9 @@ int main() {
   // filter_runTest(); // M3 T1
   transmitter_runTest(); // M3 T2
   // buffer_runTest(); // M3 T3
+  // adcCapture_runTest(); // Block capture (ISR_BLOCK_CAPTURE)
   // detector_runTest(); // M3 T3
+  // powerRank_runTest(); // Detector power ranking + benchmark
   // sound_runTest(); // M5
   printf("Tests finished");
 #endif
@@ -0,0 +1,70 @@
+#include "powerRank.h"
+
+// Constant-time ranking of the powers with a sorting network.
+
+// The 29-comparator, depth-8 sorting network for ten inputs, one layer per
+// line. X(a, b) leaves the smaller value at a and the larger at b.
+#define POWER_RANK_NETWORK(X)                                                  \
+    X(0, 8) X(1, 9) X(2, 7) X(3, 5) X(4, 6)                                    \
+    X(0, 2) X(1, 4) X(5, 8) X(7, 9)                                            \
+    X(0, 3) X(2, 4) X(5, 7) X(6, 9)                                            \
+    X(0, 1) X(3, 6) X(8, 9)                                                    \
+    X(1, 5) X(2, 3) X(4, 8) X(6, 7)                                            \
+    X(1, 2) X(3, 5) X(4, 6) X(7, 8)                                            \
+    X(2, 3) X(4, 5) X(6, 7)                                                    \
+    X(3, 4) X(5, 6)
+
+// Orders slots a and b of power[] and frequency[] without branching: the
+// power selects compile to min/max or conditional moves, and the frequency
+// numbers swap through an all-ones or all-zeros mask.
+#define POWER_RANK_COMPARE_EXCHANGE(a, b)                                      \
+    {                                                                          \
+        double powerA = power[a], powerB = power[b];                           \
+        uint16_t swapMask = -(uint16_t)(powerB < powerA);                      \
+        uint16_t difference = (frequency[a] ^ frequency[b]) & swapMask;        \
+        power[a] = (powerB < powerA) ? powerB : powerA;                        \
+        power[b] = (powerB < powerA) ? powerA : powerB;                        \
+        frequency[a] ^= difference;                                            \
+        frequency[b] ^= difference;                                            \
+    }
+
+// Sorts powers[], indexed by frequency number, into rank.
+void powerRank_sort(const double powers[], powerRank_t *rank) {
+    double *power = rank->power;
+    uint16_t *frequency = rank->frequency;
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        power[i] = powers[i];
+        frequency[i] = i;
+    }
+    POWER_RANK_NETWORK(POWER_RANK_COMPARE_EXCHANGE)
+}
+
+// Zeroes the powers and puts the frequency numbers in order, the starting
+// point for powerRank_update().
+void powerRank_init(powerRank_t *rank) {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        rank->power[i] = 0.0;
+        rank->frequency[i] = i;
+    }
+}
+
+// Same result as powerRank_sort(), with an insertion sort that starts from
+// the order rank already holds. The powers of a sliding window move little
+// from one output to the next, so this mostly makes FILTER_FREQUENCY_COUNT - 1
+// compares and moves a frequency or two by a slot, but its cost depends on
+// the powers. rank must come from powerRank_init() or an earlier sort.
+void powerRank_update(const double powers[], powerRank_t *rank) {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+        rank->power[i] = powers[rank->frequency[i]];
+    for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++) {
+        double power = rank->power[i];
+        uint16_t frequency = rank->frequency[i];
+        uint16_t j = i;
+        for (; j > 0 && rank->power[j - 1] > power; j--) {
+            rank->power[j] = rank->power[j - 1];
+            rank->frequency[j] = rank->frequency[j - 1];
+        }
+        rank->power[j] = power;
+        rank->frequency[j] = frequency;
+    }
+}
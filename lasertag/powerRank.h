@@ -0,0 +1,68 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef POWERRANK_H_
+#define POWERRANK_H_
+
+#include <stdint.h>
+
+#include "filter.h"
+
+// Ranks the FILTER_FREQUENCY_COUNT powers of one decimated output with a
+// fixed sorting network: the same 29 compare-exchanges, in the same order,
+// whatever the powers are. Each compare-exchange moves a (power, frequency
+// number) pair with selects instead of branches, so ranking takes constant
+// time and the strongest, second-strongest and median frequencies all come
+// out of one pass.
+
+// The network below is laid out for ten inputs.
+#if FILTER_FREQUENCY_COUNT != 10
+#error "powerRank.c needs a sorting network for FILTER_FREQUENCY_COUNT inputs"
+#endif
+
+// Upper median rank.
+#define POWER_RANK_MEDIAN_INDEX (FILTER_FREQUENCY_COUNT / 2)
+
+typedef struct {
+  // Powers, lowest first.
+  double power[FILTER_FREQUENCY_COUNT];
+  // frequency[i] is the frequency number of power[i].
+  uint16_t frequency[FILTER_FREQUENCY_COUNT];
+} powerRank_t;
+
+// Sorts powers[], indexed by frequency number, into rank.
+void powerRank_sort(const double powers[], powerRank_t *rank);
+
+// Zeroes the powers and puts the frequency numbers in order, the starting
+// point for powerRank_update().
+void powerRank_init(powerRank_t *rank);
+
+// Same result as powerRank_sort(), with an insertion sort that starts from
+// the order rank already holds. The powers of a sliding window move little
+// from one output to the next, so this mostly makes FILTER_FREQUENCY_COUNT - 1
+// compares and moves a frequency or two by a slot, but its cost depends on
+// the powers. rank must come from powerRank_init() or an earlier sort.
+void powerRank_update(const double powers[], powerRank_t *rank);
+
+// Returns the frequency number with the largest power.
+static inline uint16_t powerRank_strongest(const powerRank_t *rank) {
+  return rank->frequency[FILTER_FREQUENCY_COUNT - 1];
+}
+
+// Returns the frequency number with the second-largest power.
+static inline uint16_t powerRank_secondStrongest(const powerRank_t *rank) {
+  return rank->frequency[FILTER_FREQUENCY_COUNT - 2];
+}
+
+// Returns the (upper) median power.
+static inline double powerRank_medianPower(const powerRank_t *rank) {
+  return rank->power[POWER_RANK_MEDIAN_INDEX];
+}
+
+#endif /* POWERRANK_H_ */
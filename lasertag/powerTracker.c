@@ -0,0 +1,60 @@
+#include "powerTracker.h"
+#include <math.h>
+
+// Running sum of squares over a sliding window, updated in O(1) per sample.
+
+#define SQUARES_PER_UPDATE 2 // The sample leaving and the sample entering.
+
+// Starts with an empty (all-zero) window of windowSize samples. A
+// resyncInterval of 0 disables resyncing.
+void powerTracker_init(powerTracker_t *t, uint32_t windowSize,
+                       uint32_t resyncInterval) {
+    t->sum = 0.0;
+    t->windowSize = windowSize;
+    t->resyncInterval = resyncInterval;
+    t->updatesSinceResync = 0;
+    t->stats = (powerTracker_stats_t){0, 0, 0, 0, 0.0};
+}
+
+// Changes how many updates may pass between resyncs.
+void powerTracker_setResyncInterval(powerTracker_t *t, uint32_t resyncInterval) {
+    t->resyncInterval = resyncInterval;
+}
+
+// Slides the window by one sample and returns the new running sum.
+double powerTracker_update(powerTracker_t *t, double oldest, double newest) {
+    t->sum += newest * newest - oldest * oldest;
+    t->updatesSinceResync++;
+    t->stats.updateCount++;
+    t->stats.squaresComputed += SQUARES_PER_UPDATE;
+    t->stats.squaresSaved += t->windowSize - SQUARES_PER_UPDATE;
+    return t->sum;
+}
+
+// Returns true when the running sum is due to be replaced by an exact sum.
+bool powerTracker_needsResync(const powerTracker_t *t) {
+    return t->resyncInterval != 0 && t->updatesSinceResync >= t->resyncInterval;
+}
+
+// Replaces the running sum with an exact sum of the window, computed by the
+// owner, and records the drift. Returns exactSum.
+double powerTracker_resync(powerTracker_t *t, double exactSum) {
+    double drift = fabs(t->sum - exactSum);
+    if (drift > t->stats.maxDrift)
+        t->stats.maxDrift = drift;
+    t->sum = exactSum;
+    t->updatesSinceResync = 0;
+    t->stats.resyncCount++;
+    t->stats.squaresComputed += t->windowSize;
+    return exactSum;
+}
+
+// Returns the running sum of squares.
+double powerTracker_getSum(const powerTracker_t *t) {
+    return t->sum;
+}
+
+// Returns a copy of the work and drift statistics.
+powerTracker_stats_t powerTracker_getStats(const powerTracker_t *t) {
+    return t->stats;
+}
@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef POWERTRACKER_H_
+#define POWERTRACKER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Running sum of squares over a sliding window, updated in O(1) per sample.
+// Each update subtracts the square of the sample leaving the window and adds
+// the square of the sample entering it. Rounding errors from these updates
+// pile up, so the owner replaces the running sum with an exact sum every
+// resyncInterval updates (powerTracker_needsResync()). The stats show how many
+// window-length sums the incremental updates replaced and how far the running
+// sum had drifted when it was resynced.
+
+typedef struct {
+  uint32_t updateCount;     // Incremental updates since init.
+  uint32_t resyncCount;     // Exact sums since init.
+  uint64_t squaresComputed; // Squares computed by updates and resyncs.
+  uint64_t squaresSaved;    // Squares a full sum per update would have added.
+  double maxDrift;          // Largest |running - exact| seen at a resync.
+} powerTracker_stats_t;
+
+typedef struct {
+  double sum;                  // Running sum of squares.
+  uint32_t windowSize;         // Samples in the window.
+  uint32_t resyncInterval;     // Updates between resyncs, 0 = never.
+  uint32_t updatesSinceResync; // Updates since the last exact sum.
+  powerTracker_stats_t stats;
+} powerTracker_t;
+
+// Starts with an empty (all-zero) window of windowSize samples. A
+// resyncInterval of 0 disables resyncing.
+void powerTracker_init(powerTracker_t *t, uint32_t windowSize,
+                       uint32_t resyncInterval);
+
+// Changes how many updates may pass between resyncs.
+void powerTracker_setResyncInterval(powerTracker_t *t, uint32_t resyncInterval);
+
+// Slides the window by one sample and returns the new running sum.
+double powerTracker_update(powerTracker_t *t, double oldest, double newest);
+
+// Returns true when the running sum is due to be replaced by an exact sum.
+bool powerTracker_needsResync(const powerTracker_t *t);
+
+// Replaces the running sum with an exact sum of the window, computed by the
+// owner, and records the drift. Returns exactSum.
+double powerTracker_resync(powerTracker_t *t, double exactSum);
+
+// Returns the running sum of squares.
+double powerTracker_getSum(const powerTracker_t *t);
+
+// Returns a copy of the work and drift statistics.
+powerTracker_stats_t powerTracker_getStats(const powerTracker_t *t);
+
+#endif /* POWERTRACKER_H_ */
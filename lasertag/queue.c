@@ -1,122 +1,86 @@
 #include <stdio.h>  // printf
 #include <stdlib.h> // malloc, free, abort
-#include <string.h> // strncpy
+#include <string.h> // memcpy, strncpy
 
 #include "queue.h"
 
 #define QUEUE_FULL_MESSAGE "Queue full, data NOT added.\n"
 #define QUEUE_EMPTY_MESSAGE "Queue empty, no data removed.\n"
 #define QUEUE_READ_ERRORS "ERROR: Index given is not in the array\n"
-
-// Allocates memory for the queue (the data* pointer) and initializes all
-// parts of the data structure. Prints out an error message if malloc()
-// fails and calls assert(false) to print-out line-number information and
-// die. The queue is empty after initialization. To fill the queue with
-// known values (e.g. zeros), call queue_overwritePush() up to queue_size()
-// times.
-void queue_init(queue_t *q, queue_size_t size, const char *name) {
-  // Always points to the next open slot.
-  q->indexIn = 0;
-  // Always points to the next element to be removed
-  // from the queue (or "oldest" element).
-  q->indexOut = 0;
-  // Keep track of the number of elements currently in queue.
-  q->elementCount = 0;
-  // Queue capacity.
-  q->size = size;
-  // Points to a dynamically-allocated array.
-  q->data = malloc(size * sizeof(queue_data_t));
-  if (q->data == NULL)
-    abort();
-  // True if queue_pop() is called on an empty queue. Reset
-  // to false after queue_push() is called.
-  q->underflowFlag = false;
-  // True if queue_push() is called on a full queue. Reset to
-  // false once queue_pop() is called.
-  q->overflowFlag = false;
+#define QUEUE_DEBUG_TABLE_FULL_WARNING                                         \
+  "WARNING: queue debug table full, %s is untracked. Raise "                   \
+  "QUEUE_DEBUG_TABLE_SIZE.\n"
+#define QUEUE_WINDOW_ERRORS "ERROR: queue_window() needs a mirrored queue holding n elements\n"
+
+_Static_assert(QUEUE_DEBUG_TABLE_SIZE <= 256,
+               "debugIndex must be able to address the debug table");
+
+// Debugging name of one queue of any element type, kept out of the queue
+// struct.
+typedef struct {
+  // The queue that owns the entry, NULL if the entry is free.
+  const void *queue;
   // Name for debugging purposes.
-  strncpy(q->name, name, QUEUE_MAX_NAME_SIZE);
-  q->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
-}
-
-// Get the user-assigned name for the queue.
-const char *queue_name(queue_t *q) { return q->name; }
-
-// Returns the capacity of the queue.
-queue_size_t queue_size(queue_t *q) { return q->size; }
-
-// Returns true if the queue is full.
-bool queue_full(queue_t *q) { return q->size == q->elementCount; }
-
-// Returns true if the queue is empty.
-bool queue_empty(queue_t *q) { return !q->elementCount; }
-
-// If the queue is not full, pushes a new element into the queue and clears the
-// underflowFlag. IF the queue is full, set the overflowFlag, print an error
-// message and DO NOT change the queue.
-void queue_push(queue_t *q, queue_data_t value) {
-  if (!queue_full(q)) {
-    q->data[q->indexIn] = value;
-    q->elementCount++;
-    q->indexIn = ++q->indexIn % q->size;
-    q->underflowFlag = false;
-  } else {
-    q->overflowFlag = true;
-    printf(QUEUE_FULL_MESSAGE);
-  }
+  char name[QUEUE_MAX_NAME_SIZE];
+} queue_debugInfo_t;
+
+static queue_debugInfo_t debugTable[QUEUE_DEBUG_TABLE_SIZE];
+
+// Returns the side table entry of queue, whose debugIndex field holds
+// debugIndex, or NULL if queue has none.
+static queue_debugInfo_t *debugInfo(const void *queue, uint8_t debugIndex) {
+  if (debugIndex < QUEUE_DEBUG_TABLE_SIZE &&
+      debugTable[debugIndex].queue == queue)
+    return &debugTable[debugIndex];
+  return NULL;
 }
 
-// If the queue is not empty, remove and return the oldest element in the queue.
-// If the queue is empty, set the underflowFlag, print an error message, and
-// DO NOT change the queue.
-queue_data_t queue_pop(queue_t *q) {
-  queue_data_t valueRemoved;
-
-  if (!queue_empty(q)) {
-    valueRemoved = q->data[q->indexOut];
-    q->elementCount--;
-    q->indexOut = ++q->indexOut % q->size;
-    q->overflowFlag = false;
-    return valueRemoved;
-  } else {
-    q->underflowFlag = true;
-    printf(QUEUE_EMPTY_MESSAGE);
-    return QUEUE_RETURN_ERROR_VALUE;
+// Points *debugIndex, the debugIndex field of queue, at a side table entry for
+// queue and returns it: the one it already owns if it is being initialized
+// again, else a free one. *debugIndex may hold garbage; an entry only counts
+// if it points back at queue. If the table is full, prints a warning naming
+// the queue and returns NULL; the queue still works but reports
+// QUEUE_UNTRACKED_NAME.
+static queue_debugInfo_t *claimDebugInfo(const void *queue, uint8_t *debugIndex,
+                                         const char *name) {
+  queue_debugInfo_t *info = debugInfo(queue, *debugIndex);
+  if (info)
+    return info;
+  for (uint32_t i = 0; i < QUEUE_DEBUG_TABLE_SIZE; i++) {
+    if (debugTable[i].queue == NULL) {
+      debugTable[i].queue = queue;
+      *debugIndex = i;
+      return &debugTable[i];
+    }
   }
+  printf(QUEUE_DEBUG_TABLE_FULL_WARNING, name);
+  return NULL;
 }
 
-// If the queue is full, call queue_pop() and then call queue_push().
-// If the queue is not full, just call queue_push().
-void queue_overwritePush(queue_t *q, queue_data_t value) {
-  if (queue_full(q))
-    queue_pop(q);
-
-  queue_push(q, value);
-}
-
-// Provides random-access read capability to the queue.
-// Low-valued indexes access older queue elements while higher-value indexes
-// access newer elements (according to the order that they were added).
-// Print a meaningful error message if an error condition is detected.
-queue_data_t queue_readElementAt(queue_t *q, queue_index_t index) {
-  if (index > q->size || index < 0) {
-    printf(QUEUE_READ_ERRORS);
-    return QUEUE_RETURN_ERROR_VALUE;
-  }
-
-  return q->data[(q->indexOut + index) % q->size];
+// Returns the number of data slots a queue of size needs in layout, for every
+// element type. Same value as the QUEUE_*_STORAGE_LENGTH() macros.
+queue_size_t queue_storageLength(queue_size_t size, queue_layout_t layout) {
+  if (layout == QUEUE_LAYOUT_MODULO)
+    return size;
+  queue_size_t storageSize = 1;
+  while (storageSize < size)
+    storageSize <<= 1;
+  return (layout == QUEUE_LAYOUT_MIRRORED) ? 2 * storageSize : storageSize;
 }
 
-// Returns a count of the elements currently contained in the queue.
-queue_size_t queue_elementCount(queue_t *q) { return q->elementCount; }
+// The functions of every element type declared in queue.h.
+#define QUEUE_TEMPLATE_PREFIX queue
+#define QUEUE_TEMPLATE_TYPE double
+#include "queueTemplateImpl.h"
 
-// Returns true if an underflow has occurred (queue_pop() called on an empty
-// queue).
-bool queue_underflow(queue_t *q) { return q->underflowFlag; }
+#define QUEUE_TEMPLATE_PREFIX queueFloat
+#define QUEUE_TEMPLATE_TYPE float
+#include "queueTemplateImpl.h"
 
-// Returns true if an overflow has occurred (queue_push() called on a full
-// queue).
-bool queue_overflow(queue_t *q) { return q->overflowFlag; }
+#define QUEUE_TEMPLATE_PREFIX queueInt32
+#define QUEUE_TEMPLATE_TYPE int32_t
+#include "queueTemplateImpl.h"
 
-// Frees the storage that you malloc'd before.
-void queue_garbageCollect(queue_t *q) { free(q->data); }
\ No newline at end of file
+#define QUEUE_TEMPLATE_PREFIX queueInt16
+#define QUEUE_TEMPLATE_TYPE int16_t
+#include "queueTemplateImpl.h"
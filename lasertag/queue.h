@@ -13,99 +13,101 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdbool.h>
 #include <stdint.h>
 
+// A queue made with queue_initPowerOfTwo() rounds its storage up to a power of
+// two and wraps its indices with a mask instead of a modulo. Its capacity is
+// still the size it was given. Power-of-two queues also support the inline
+// queue_*Fast() accessors below: with NDEBUG defined (release builds) they
+// skip all error checks; otherwise they are the checked functions.
+// A queue made with queue_initMirrored() is a power-of-two queue that stores
+// every element twice, at slot and slot + data array length, so that the
+// newest n elements are always contiguous: queue_window() returns them as a
+// plain array for the inner loops of the filters.
+// The queue_init*() functions malloc() the data array. queue_initInStorage()
+// takes a caller-supplied array instead, e.g. static storage sized with the
+// QUEUE_*_STORAGE_LENGTH() macros, for code that must not use the heap.
+// queue_t holds doubles. queueFloat_t, queueInt32_t and queueInt16_t hold
+// float, int32_t and int16_t elements and have the same functions under their
+// own prefix, e.g. queueInt16_push(). All of them are made from one
+// implementation, queueTemplate.h and queueTemplateImpl.h, instantiated once
+// per element type.
+
 // Limit the size of the statically-allocated queue name.
 #define QUEUE_MAX_NAME_SIZE 50
 
+// Name reported by a queue that holds no debug side table entry (see queue_t),
+// e.g. after queue_garbageCollect() or when the table was full.
+#define QUEUE_UNTRACKED_NAME "(untracked)"
+
 // Return this when queue_pop(), queue_readElementAt() needs to return something
-// during an error condition.
-#define QUEUE_RETURN_ERROR_VALUE ((queue_data_t)0)
+// during an error condition. Converted to the element type of the queue.
+#define QUEUE_RETURN_ERROR_VALUE 0
 
 // Big enough to address everything in the queue.
 typedef uint32_t queue_index_t;
 
-// Just make everything double for this project.
-typedef double queue_data_t;
-
 // Not sure we need something different from the index type.
 typedef uint32_t queue_size_t;
 
-// The queue struct with elementCount to speed up computations to determine
-// element count. Queue will use the empty location and pointer arithmetic to
-// determine full and empty.
-typedef struct {
-  // Always points to the next open slot.
-  queue_index_t indexIn;
-  // Always points to the next element to be removed
-  // from the queue (or "oldest" element).
-  queue_index_t indexOut;
-  // Keep track of the number of elements currently in queue.
-  queue_size_t elementCount;
-  // This is the size of the data array. Actual queue
-  // capacity is one less.
-  queue_size_t size;
-  // Points to a dynamically-allocated array.
-  queue_data_t *data;
-  // True if queue_pop() is called on an empty queue. Reset
-  // to false after queue_push() is called.
-  bool underflowFlag;
-  // True if queue_push() is called on a full queue. Reset to
-  // false once queue_pop() is called.
-  bool overflowFlag;
-  // Name for debugging purposes.
-  char name[QUEUE_MAX_NAME_SIZE];
-} queue_t;
-
-// Allocates memory for the queue (the data* pointer) and initializes all
-// parts of the data structure. Prints out an error message if malloc() fails
-// and calls assert(false) to print-out line-number information and die.
-// The queue is empty after initialization. To fill the queue with known
-// values (e.g. zeros), call queue_overwritePush() up to queue_size() times.
-void queue_init(queue_t *q, queue_size_t size, const char *name);
-
-// Get the user-assigned name for the queue.
-const char *queue_name(queue_t *q);
-
-// Returns the capacity of the queue.
-queue_size_t queue_size(queue_t *q);
-
-// Returns true if the queue is full.
-bool queue_full(queue_t *q);
-
-// Returns true if the queue is empty.
-bool queue_empty(queue_t *q);
-
-// If the queue is not full, pushes a new element into the queue and clears the
-// underflowFlag. IF the queue is full, set the overflowFlag, print an error
-// message and DO NOT change the queue.
-void queue_push(queue_t *q, queue_data_t value);
-
-// If the queue is not empty, remove and return the oldest element in the queue.
-// If the queue is empty, set the underflowFlag, print an error message, and DO
-// NOT change the queue.
-queue_data_t queue_pop(queue_t *q);
-
-// If the queue is full, call queue_pop() and then call queue_push().
-// If the queue is not full, just call queue_push().
-void queue_overwritePush(queue_t *q, queue_data_t value);
-
-// Provides random-access read capability to the queue.
-// Low-valued indexes access older queue elements while higher-value indexes
-// access newer elements (according to the order that they were added). Print a
-// meaningful error message if an error condition is detected.
-queue_data_t queue_readElementAt(queue_t *q, queue_index_t index);
-
-// Returns a count of the elements currently contained in the queue.
-queue_size_t queue_elementCount(queue_t *q);
-
-// Returns true if an underflow has occurred (queue_pop() called on an empty
-// queue).
-bool queue_underflow(queue_t *q);
-
-// Returns true if an overflow has occurred (queue_push() called on a full
-// queue).
-bool queue_overflow(queue_t *q);
-
-// Frees the storage that you malloc'd before.
-void queue_garbageCollect(queue_t *q);
-
-#endif /* QUEUE_H_ */
\ No newline at end of file
+// Data array layouts, one per queue_init*() function.
+typedef enum {
+  QUEUE_LAYOUT_MODULO,       // queue_init().
+  QUEUE_LAYOUT_POWER_OF_TWO, // queue_initPowerOfTwo().
+  QUEUE_LAYOUT_MIRRORED      // queue_initMirrored().
+} queue_layout_t;
+
+// Smallest power of two >= size, for size >= 1, as a constant expression.
+#define QUEUE_SMEAR_BITS_(x)                                                   \
+  ((x) | (x) >> 1 | (x) >> 2 | (x) >> 3 | (x) >> 4 | (x) >> 5 | (x) >> 6 |      \
+   (x) >> 7 | (x) >> 8 | (x) >> 9 | (x) >> 10 | (x) >> 11 | (x) >> 12 |         \
+   (x) >> 13 | (x) >> 14 | (x) >> 15 | (x) >> 16 | (x) >> 17 | (x) >> 18 |      \
+   (x) >> 19 | (x) >> 20 | (x) >> 21 | (x) >> 22 | (x) >> 23 | (x) >> 24 |      \
+   (x) >> 25 | (x) >> 26 | (x) >> 27 | (x) >> 28 | (x) >> 29 | (x) >> 30 |      \
+   (x) >> 31)
+#define QUEUE_POWER_OF_TWO_CEILING(size)                                       \
+  (QUEUE_SMEAR_BITS_((uint32_t)(size) - 1) + 1)
+
+// Data array lengths, in element slots, for queue_initInStorage().
+#define QUEUE_MODULO_STORAGE_LENGTH(size) (size)
+#define QUEUE_POWER_OF_TWO_STORAGE_LENGTH(size) QUEUE_POWER_OF_TWO_CEILING(size)
+#define QUEUE_MIRRORED_STORAGE_LENGTH(size) (2 * QUEUE_POWER_OF_TWO_CEILING(size))
+
+// Queue headers are aligned to, and on a 32-bit target fill, one cache line
+// of the Cortex-A9.
+#define QUEUE_CACHE_LINE_SIZE 32
+
+// Queues that can have a name at the same time. Each queue claims an entry of
+// a side table in queue.c when it is initialized and hands it back in
+// queue_garbageCollect(). A queue initialized while the table is full prints
+// a warning and reports QUEUE_UNTRACKED_NAME; it works otherwise.
+#define QUEUE_DEBUG_TABLE_SIZE 64
+
+// Returns the number of data slots a queue of size needs in layout, for every
+// element type. Same value as the QUEUE_*_STORAGE_LENGTH() macros.
+queue_size_t queue_storageLength(queue_size_t size, queue_layout_t layout);
+
+// Token pasting for queueTemplate.h.
+#define QUEUE_PASTE_(a, b) a##b
+#define QUEUE_CAT_(a, b) QUEUE_PASTE_(a, b)
+#define QUEUE_TEMPLATE_NAME_(suffix) QUEUE_CAT_(QUEUE_TEMPLATE_PREFIX, suffix)
+
+// Just make everything double for this project: queue_t, queue_init(), ...
+#define QUEUE_TEMPLATE_PREFIX queue
+#define QUEUE_TEMPLATE_TYPE double
+#include "queueTemplate.h"
+
+// queueFloat_t, queueFloat_init(), ...
+#define QUEUE_TEMPLATE_PREFIX queueFloat
+#define QUEUE_TEMPLATE_TYPE float
+#include "queueTemplate.h"
+
+// queueInt32_t, queueInt32_init(), ...
+#define QUEUE_TEMPLATE_PREFIX queueInt32
+#define QUEUE_TEMPLATE_TYPE int32_t
+#include "queueTemplate.h"
+
+// queueInt16_t, queueInt16_init(), ...
+#define QUEUE_TEMPLATE_PREFIX queueInt16
+#define QUEUE_TEMPLATE_TYPE int16_t
+#include "queueTemplate.h"
+
+#endif /* QUEUE_H_ */
@@ -0,0 +1,215 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// No include guard: queue.h includes this once per element type.
+// Declares the queue type QUEUE_TEMPLATE_PREFIX##_t with elements of type
+// QUEUE_TEMPLATE_TYPE (also typedef'd as QUEUE_TEMPLATE_PREFIX##_data_t) and
+// its functions QUEUE_TEMPLATE_PREFIX##_init() and so on. The comments below
+// use the names of the double queue, queue_t; every other element type has
+// the same functions under its own prefix.
+
+#if !defined(QUEUE_TEMPLATE_PREFIX) || !defined(QUEUE_TEMPLATE_TYPE)
+#error "Define QUEUE_TEMPLATE_PREFIX and QUEUE_TEMPLATE_TYPE first"
+#endif
+
+#define QT QUEUE_TEMPLATE_NAME_(_t)
+#define QD QUEUE_TEMPLATE_NAME_(_data_t)
+#define QF(name) QUEUE_TEMPLATE_NAME_(QUEUE_CAT_(_, name))
+
+typedef QUEUE_TEMPLATE_TYPE QD;
+
+// The queue struct with elementCount to speed up computations to determine
+// element count. Queue will use the empty location and pointer arithmetic to
+// determine full and empty.
+// The struct only holds the fields that pushes, pops and reads need. The name
+// lives in a side table in queue.c; the flags fit in what would otherwise be
+// padding of the cache line.
+typedef struct {
+  // Points to a dynamically-allocated array, or the caller's array for
+  // queue_initInStorage().
+  QD *data;
+  // Always points to the next open slot.
+  queue_index_t indexIn;
+  // Always points to the next element to be removed
+  // from the queue (or "oldest" element).
+  queue_index_t indexOut;
+  // Keep track of the number of elements currently in queue.
+  queue_size_t elementCount;
+  // The capacity of the queue. Also the size of the data array, unless the
+  // queue was made with queue_initPowerOfTwo().
+  queue_size_t size;
+  // Size of the data array minus one for queue_initPowerOfTwo(), 0 otherwise.
+  // For queue_initMirrored() this is the size of one copy minus one.
+  queue_index_t indexMask;
+  // Distance from a slot to its mirror copy, 0 if the queue is not mirrored.
+  // Pushes store to both slots; with no mirror that is the same slot twice.
+  queue_index_t mirrorOffset;
+  // True if data was malloc'd by queue_init*() and is freed by
+  // queue_garbageCollect().
+  bool ownsData;
+  // Entry of the debug side table that holds the name.
+  uint8_t debugIndex;
+  // True if queue_pop() is called on an empty queue. Reset
+  // to false after queue_push() is called.
+  bool underflowFlag;
+  // True if queue_push() is called on a full queue. Reset to
+  // false once queue_pop() is called.
+  bool overflowFlag;
+} __attribute__((aligned(QUEUE_CACHE_LINE_SIZE))) QT;
+
+// Allocates memory for the queue (the data* pointer) and initializes all
+// parts of the data structure. Prints out an error message if malloc() fails
+// and calls assert(false) to print-out line-number information and die.
+// The queue is empty after initialization. To fill the queue with known
+// values (e.g. zeros), call queue_fill().
+void QF(init)(QT *q, queue_size_t size, const char *name);
+
+// Initializes all parts of the data structure on storage supplied by the
+// caller, at least queue_storageLength(size, layout) slots, e.g. a static
+// array sized with the QUEUE_*_STORAGE_LENGTH() macros. Nothing is
+// allocated and queue_garbageCollect() leaves the storage alone. The queue is
+// empty after initialization.
+void QF(initInStorage)(QT *q, queue_size_t size, queue_layout_t layout,
+                       QD *storage, const char *name);
+
+// Same as queue_init(), but the data array is rounded up to a power of two so
+// that indices wrap with a mask. The capacity is still size.
+void QF(initPowerOfTwo)(QT *q, queue_size_t size, const char *name);
+
+// Same as queue_initPowerOfTwo(), but every element is also stored a second
+// time, one data array length further on, so that queue_window() can return
+// the newest elements as one contiguous span. Doubles the storage.
+void QF(initMirrored)(QT *q, queue_size_t size, const char *name);
+
+// Get the user-assigned name for the queue. A queue that was garbage
+// collected, or initialized while the debug table was full, reports
+// QUEUE_UNTRACKED_NAME.
+const char *QF(name)(QT *q);
+
+// Returns the capacity of the queue.
+queue_size_t QF(size)(QT *q);
+
+// Returns true if the queue is full.
+bool QF(full)(QT *q);
+
+// Returns true if the queue is empty.
+bool QF(empty)(QT *q);
+
+// If the queue is not full, pushes a new element into the queue and clears the
+// underflowFlag. IF the queue is full, set the overflowFlag, print an error
+// message and DO NOT change the queue.
+void QF(push)(QT *q, QD value);
+
+// If the queue is not empty, remove and return the oldest element in the queue.
+// If the queue is empty, set the underflowFlag, print an error message, and DO
+// NOT change the queue.
+QD QF(pop)(QT *q);
+
+// If the queue is full, call queue_pop() and then call queue_push().
+// If the queue is not full, just call queue_push().
+void QF(overwritePush)(QT *q, QD value);
+
+// If the queue has room for count more elements, pushes values[0] through
+// values[count - 1] (oldest first) and clears the underflowFlag. Otherwise
+// sets the overflowFlag, prints an error message and does NOT change the
+// queue. Copies at most two contiguous spans.
+void QF(pushMany)(QT *q, const QD values[], queue_size_t count);
+
+// Same as calling queue_overwritePush() on values[0] through
+// values[count - 1]: the oldest elements make room for the new ones, and only
+// the newest queue_size() values are kept if count is larger.
+void QF(overwritePushMany)(QT *q, const QD values[], queue_size_t count);
+
+// If the queue holds at least count elements, removes the oldest count of them
+// into dst[] (oldest first) and clears the overflowFlag. Otherwise sets the
+// underflowFlag, prints an error message and does NOT change the queue.
+// Copies at most two contiguous spans.
+void QF(popMany)(QT *q, QD dst[], queue_size_t count);
+
+// Fills the queue with queue_size() copies of value, replacing its contents,
+// and clears both flags. Same contents as calling queue_overwritePush()
+// queue_size() times.
+void QF(fill)(QT *q, QD value);
+
+// Provides random-access read capability to the queue.
+// Low-valued indexes access older queue elements while higher-value indexes
+// access newer elements (according to the order that they were added). Print a
+// meaningful error message if an error condition is detected.
+QD QF(readElementAt)(const QT *q, queue_index_t index);
+
+// Points *span at the newest n elements of a queue made with
+// queue_initMirrored(), oldest first: (*span)[i] is
+// queue_readElementAt(q, queue_elementCount(q) - n + i). The span stays valid
+// until the next push. Returns false, and prints an error message, if q is
+// not mirrored or holds fewer than n elements.
+bool QF(window)(const QT *q, queue_size_t n, const QD **span);
+
+// Returns a count of the elements currently contained in the queue.
+queue_size_t QF(elementCount)(QT *q);
+
+// Returns true if an underflow has occurred (queue_pop() called on an empty
+// queue).
+bool QF(underflow)(QT *q);
+
+// Returns true if an overflow has occurred (queue_push() called on a full
+// queue).
+bool QF(overflow)(QT *q);
+
+// Frees the storage that you malloc'd before. Storage passed to
+// queue_initInStorage() belongs to the caller and is not freed. Also hands
+// the queue's debug side table entry back.
+void QF(garbageCollect)(QT *q);
+
+// Inline accessors for the inner loops of the filters. q must come from
+// queue_initPowerOfTwo(). With NDEBUG they trust the caller: the index must
+// be below queue_elementCount(), queue_popFast() needs a non-empty queue, and
+// the underflow and overflow flags are left alone. Without NDEBUG they call
+// the checked functions.
+
+// Same as queue_readElementAt().
+static inline QD QF(readElementAtFast)(const QT *q, queue_index_t index) {
+#ifdef NDEBUG
+  return q->data[(q->indexOut + index) & q->indexMask];
+#else
+  return QF(readElementAt)(q, index);
+#endif
+}
+
+// Same as queue_pop().
+static inline QD QF(popFast)(QT *q) {
+#ifdef NDEBUG
+  QD value = q->data[q->indexOut];
+  q->indexOut = (q->indexOut + 1) & q->indexMask;
+  q->elementCount--;
+  return value;
+#else
+  return QF(pop)(q);
+#endif
+}
+
+// Same as queue_overwritePush().
+static inline void QF(overwritePushFast)(QT *q, QD value) {
+#ifdef NDEBUG
+  q->data[q->indexIn] = value;
+  q->data[q->indexIn + q->mirrorOffset] = value;
+  q->indexIn = (q->indexIn + 1) & q->indexMask;
+  if (q->elementCount == q->size)
+    q->indexOut = (q->indexOut + 1) & q->indexMask;
+  else
+    q->elementCount++;
+#else
+  QF(overwritePush)(q, value);
+#endif
+}
+
+#undef QT
+#undef QD
+#undef QF
+#undef QUEUE_TEMPLATE_PREFIX
+#undef QUEUE_TEMPLATE_TYPE
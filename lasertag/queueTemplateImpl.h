@@ -0,0 +1,323 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// No include guard: queue.c includes this once per element type, after
+// defining QUEUE_TEMPLATE_PREFIX and QUEUE_TEMPLATE_TYPE as for
+// queueTemplate.h. Defines the functions declared there. Relies on the side
+// table helpers and the error messages in queue.c.
+
+#define QT QUEUE_TEMPLATE_NAME_(_t)
+#define QD QUEUE_TEMPLATE_NAME_(_data_t)
+#define QF(name) QUEUE_TEMPLATE_NAME_(QUEUE_CAT_(_, name))
+
+// On a 32-bit target the hot fields of the queue fit in one cache line.
+_Static_assert(sizeof(QD *) > 4 || sizeof(QT) == QUEUE_CACHE_LINE_SIZE,
+               "queue headers must fill exactly one cache line");
+
+// Returns the side table entry of q, NULL if it holds none.
+static queue_debugInfo_t *QF(debugInfo)(const QT *q) {
+  return debugInfo(q, q->debugIndex);
+}
+
+// Returns the number of slots the indices wrap at (one copy if mirrored).
+static queue_size_t QF(storageSize)(const QT *q) {
+  return q->indexMask ? q->indexMask + 1 : q->size;
+}
+
+// Returns the data array index count slots after index, count <= size.
+static queue_index_t QF(advanceIndex)(const QT *q, queue_index_t index,
+                                      queue_size_t count) {
+  if (q->indexMask)
+    return (index + count) & q->indexMask;
+  // Modulo queues store exactly size slots, so one subtraction wraps.
+  index += count;
+  return (index >= q->size) ? index - q->size : index;
+}
+
+// Returns the data array index that follows index.
+static queue_index_t QF(nextIndex)(QT *q, queue_index_t index) {
+  return QF(advanceIndex)(q, index, 1);
+}
+
+// Copies count values to the slots starting at slot, and to their mirror
+// copies: at most two contiguous spans each. count <= size.
+static void QF(copyIn)(QT *q, queue_index_t slot, const QD values[],
+                       queue_size_t count) {
+  queue_size_t slotsToEnd = QF(storageSize)(q) - slot;
+  queue_size_t firstSpan = (count < slotsToEnd) ? count : slotsToEnd;
+  memcpy(&q->data[slot], values, firstSpan * sizeof(QD));
+  memcpy(&q->data[0], &values[firstSpan], (count - firstSpan) * sizeof(QD));
+  if (q->mirrorOffset) {
+    memcpy(&q->data[slot + q->mirrorOffset], values, firstSpan * sizeof(QD));
+    memcpy(&q->data[q->mirrorOffset], &values[firstSpan],
+           (count - firstSpan) * sizeof(QD));
+  }
+}
+
+// Initializes all parts of the data structure on storage supplied by the
+// caller, at least queue_storageLength(size, layout) slots, e.g. a static
+// array sized with the QUEUE_*_STORAGE_LENGTH() macros. Nothing is
+// allocated and queue_garbageCollect() leaves the storage alone. The queue is
+// empty after initialization.
+void QF(initInStorage)(QT *q, queue_size_t size, queue_layout_t layout,
+                       QD *storage, const char *name) {
+  queue_size_t storageLength = queue_storageLength(size, layout);
+  // Always points to the next open slot.
+  q->indexIn = 0;
+  // Always points to the next element to be removed
+  // from the queue (or "oldest" element).
+  q->indexOut = 0;
+  // Keep track of the number of elements currently in queue.
+  q->elementCount = 0;
+  // Queue capacity.
+  q->size = size;
+  // Modulo indexing wraps at size; the other layouts wrap with a mask at one
+  // copy of the data array.
+  if (layout == QUEUE_LAYOUT_MODULO)
+    q->indexMask = 0;
+  else if (layout == QUEUE_LAYOUT_MIRRORED)
+    q->indexMask = storageLength / 2 - 1;
+  else
+    q->indexMask = storageLength - 1;
+  // The mirrored layout keeps a second copy right after the first one.
+  q->mirrorOffset = (layout == QUEUE_LAYOUT_MIRRORED) ? storageLength / 2 : 0;
+  // Points to the caller's array.
+  q->data = storage;
+  q->ownsData = false;
+  q->underflowFlag = false;
+  q->overflowFlag = false;
+  // The name goes in the side table.
+  queue_debugInfo_t *info = claimDebugInfo(q, &q->debugIndex, name);
+  if (info) {
+    strncpy(info->name, name, QUEUE_MAX_NAME_SIZE);
+    info->name[QUEUE_MAX_NAME_SIZE - 1] = '\0';
+  }
+}
+
+// Allocates the data array for layout, then calls queue_initInStorage().
+// Calls abort() if malloc() fails.
+static void QF(initAllocated)(QT *q, queue_size_t size,
+                              queue_layout_t layout, const char *name) {
+  QD *storage = malloc(queue_storageLength(size, layout) * sizeof(QD));
+  if (storage == NULL)
+    abort();
+  QF(initInStorage)(q, size, layout, storage, name);
+  q->ownsData = true;
+}
+
+// Allocates memory for the queue (the data* pointer) and initializes all
+// parts of the data structure. Prints out an error message if malloc()
+// fails and calls assert(false) to print-out line-number information and
+// die. The queue is empty after initialization. To fill the queue with
+// known values (e.g. zeros), call queue_fill().
+void QF(init)(QT *q, queue_size_t size, const char *name) {
+  QF(initAllocated)(q, size, QUEUE_LAYOUT_MODULO, name);
+}
+
+// Same as queue_init(), but the data array is rounded up to a power of two so
+// that indices wrap with a mask. The capacity is still size.
+void QF(initPowerOfTwo)(QT *q, queue_size_t size, const char *name) {
+  QF(initAllocated)(q, size, QUEUE_LAYOUT_POWER_OF_TWO, name);
+}
+
+// Same as queue_initPowerOfTwo(), but every element is also stored a second
+// time, one data array length further on, so that queue_window() can return
+// the newest elements as one contiguous span. Doubles the storage.
+void QF(initMirrored)(QT *q, queue_size_t size, const char *name) {
+  QF(initAllocated)(q, size, QUEUE_LAYOUT_MIRRORED, name);
+}
+
+// Get the user-assigned name for the queue. A queue that was garbage
+// collected, or initialized while the debug table was full, reports
+// QUEUE_UNTRACKED_NAME.
+const char *QF(name)(QT *q) {
+  queue_debugInfo_t *info = QF(debugInfo)(q);
+  return info ? info->name : QUEUE_UNTRACKED_NAME;
+}
+
+// Returns the capacity of the queue.
+queue_size_t QF(size)(QT *q) { return q->size; }
+
+// Returns true if the queue is full.
+bool QF(full)(QT *q) { return q->size == q->elementCount; }
+
+// Returns true if the queue is empty.
+bool QF(empty)(QT *q) { return !q->elementCount; }
+
+// If the queue is not full, pushes a new element into the queue and clears the
+// underflowFlag. IF the queue is full, set the overflowFlag, print an error
+// message and DO NOT change the queue.
+void QF(push)(QT *q, QD value) {
+  if (!QF(full)(q)) {
+    q->data[q->indexIn] = value;
+    q->data[q->indexIn + q->mirrorOffset] = value;
+    q->elementCount++;
+    q->indexIn = QF(nextIndex)(q, q->indexIn);
+    q->underflowFlag = false;
+  } else {
+    q->overflowFlag = true;
+    printf(QUEUE_FULL_MESSAGE);
+  }
+}
+
+// If the queue is not empty, remove and return the oldest element in the queue.
+// If the queue is empty, set the underflowFlag, print an error message, and
+// DO NOT change the queue.
+QD QF(pop)(QT *q) {
+  QD valueRemoved;
+
+  if (!QF(empty)(q)) {
+    valueRemoved = q->data[q->indexOut];
+    q->elementCount--;
+    q->indexOut = QF(nextIndex)(q, q->indexOut);
+    q->overflowFlag = false;
+    return valueRemoved;
+  } else {
+    q->underflowFlag = true;
+    printf(QUEUE_EMPTY_MESSAGE);
+    return QUEUE_RETURN_ERROR_VALUE;
+  }
+}
+
+// If the queue is full, call queue_pop() and then call queue_push().
+// If the queue is not full, just call queue_push().
+void QF(overwritePush)(QT *q, QD value) {
+  if (QF(full)(q))
+    QF(pop)(q);
+
+  QF(push)(q, value);
+}
+
+// If the queue has room for count more elements, pushes values[0] through
+// values[count - 1] (oldest first) and clears the underflowFlag. Otherwise
+// sets the overflowFlag, prints an error message and does NOT change the
+// queue. Copies at most two contiguous spans.
+void QF(pushMany)(QT *q, const QD values[], queue_size_t count) {
+  if (count > q->size - q->elementCount) {
+    q->overflowFlag = true;
+    printf(QUEUE_FULL_MESSAGE);
+    return;
+  }
+  QF(copyIn)(q, q->indexIn, values, count);
+  q->indexIn = QF(advanceIndex)(q, q->indexIn, count);
+  q->elementCount += count;
+  q->underflowFlag = false;
+}
+
+// Same as calling queue_overwritePush() on values[0] through
+// values[count - 1]: the oldest elements make room for the new ones, and only
+// the newest queue_size() values are kept if count is larger.
+void QF(overwritePushMany)(QT *q, const QD values[], queue_size_t count) {
+  if (count > q->size) {
+    values += count - q->size;
+    count = q->size;
+  }
+  queue_size_t freeCount = q->size - q->elementCount;
+  if (count > freeCount) {
+    queue_size_t dropCount = count - freeCount;
+    q->indexOut = QF(advanceIndex)(q, q->indexOut, dropCount);
+    q->elementCount -= dropCount;
+    q->overflowFlag = false;
+  }
+  QF(pushMany)(q, values, count);
+}
+
+// If the queue holds at least count elements, removes the oldest count of them
+// into dst[] (oldest first) and clears the overflowFlag. Otherwise sets the
+// underflowFlag, prints an error message and does NOT change the queue.
+// Copies at most two contiguous spans.
+void QF(popMany)(QT *q, QD dst[], queue_size_t count) {
+  if (count > q->elementCount) {
+    q->underflowFlag = true;
+    printf(QUEUE_EMPTY_MESSAGE);
+    return;
+  }
+  queue_size_t slotsToEnd = QF(storageSize)(q) - q->indexOut;
+  queue_size_t firstSpan = (count < slotsToEnd) ? count : slotsToEnd;
+  memcpy(dst, &q->data[q->indexOut], firstSpan * sizeof(QD));
+  memcpy(&dst[firstSpan], &q->data[0], (count - firstSpan) * sizeof(QD));
+  q->indexOut = QF(advanceIndex)(q, q->indexOut, count);
+  q->elementCount -= count;
+  q->overflowFlag = false;
+}
+
+// Fills the queue with queue_size() copies of value, replacing its contents,
+// and clears both flags. Same contents as calling queue_overwritePush()
+// queue_size() times.
+void QF(fill)(QT *q, QD value) {
+  for (queue_index_t i = 0; i < q->size; i++)
+    q->data[i] = value;
+  if (q->mirrorOffset)
+    memcpy(&q->data[q->mirrorOffset], q->data, q->size * sizeof(QD));
+  q->indexOut = 0;
+  q->indexIn = QF(advanceIndex)(q, 0, q->size);
+  q->elementCount = q->size;
+  q->underflowFlag = false;
+  q->overflowFlag = false;
+}
+
+// Provides random-access read capability to the queue.
+// Low-valued indexes access older queue elements while higher-value indexes
+// access newer elements (according to the order that they were added).
+// Print a meaningful error message if an error condition is detected.
+QD QF(readElementAt)(const QT *q, queue_index_t index) {
+  if (index >= q->size) {
+    printf(QUEUE_READ_ERRORS);
+    return QUEUE_RETURN_ERROR_VALUE;
+  }
+
+  if (q->indexMask)
+    return q->data[(q->indexOut + index) & q->indexMask];
+  // index < size, so one subtraction wraps the sum.
+  index += q->indexOut;
+  return q->data[index >= q->size ? index - q->size : index];
+}
+
+// Points *span at the newest n elements of a queue made with
+// queue_initMirrored(), oldest first: (*span)[i] is
+// queue_readElementAt(q, queue_elementCount(q) - n + i). The span stays valid
+// until the next push. Returns false, and prints an error message, if q is
+// not mirrored or holds fewer than n elements.
+bool QF(window)(const QT *q, queue_size_t n, const QD **span) {
+  if (!q->mirrorOffset || n > q->elementCount) {
+    printf(QUEUE_WINDOW_ERRORS);
+    return false;
+  }
+  // The copy at slot + mirrorOffset continues the data array past its end.
+  *span = &q->data[(q->indexIn - n) & q->indexMask];
+  return true;
+}
+
+// Returns a count of the elements currently contained in the queue.
+queue_size_t QF(elementCount)(QT *q) { return q->elementCount; }
+
+// Returns true if an underflow has occurred (queue_pop() called on an empty
+// queue).
+bool QF(underflow)(QT *q) { return q->underflowFlag; }
+
+// Returns true if an overflow has occurred (queue_push() called on a full
+// queue).
+bool QF(overflow)(QT *q) { return q->overflowFlag; }
+
+// Frees the storage that you malloc'd before. Storage passed to
+// queue_initInStorage() belongs to the caller and is not freed. Also hands
+// the queue's debug side table entry back.
+void QF(garbageCollect)(QT *q) {
+  if (q->ownsData)
+    free(q->data);
+  queue_debugInfo_t *info = QF(debugInfo)(q);
+  if (info)
+    info->queue = NULL;
+}
+
+#undef QT
+#undef QD
+#undef QF
+#undef QUEUE_TEMPLATE_PREFIX
+#undef QUEUE_TEMPLATE_TYPE
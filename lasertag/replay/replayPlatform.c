@@ -0,0 +1,117 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Host stand-ins for the board code that the detector pulls in: the interval
+// timers run on the Linux monotonic clock and the hit LED does nothing.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "hitLedTimer.h"
+#include "intervalTimer.h"
+
+#define TIMER_COUNT 3
+
+typedef struct {
+  struct timespec startTime; // When the timer was last started.
+  double totalSeconds;       // Running time before startTime.
+  bool running;
+} hostTimer_t;
+
+static hostTimer_t timers[TIMER_COUNT];
+
+// Returns the seconds from start to end.
+static double secondsBetween(const struct timespec *start,
+                             const struct timespec *end) {
+  return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+// You must initialize the timers before you use them the first time.
+intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
+  if (timerNumber >= TIMER_COUNT)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  intervalTimer_reset(timerNumber);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+// Simply calls intervalTimer_init() on all timers.
+intervalTimer_status_t intervalTimer_initAll() {
+  for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    intervalTimer_init(i);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+// If the interval timer is already running, this function does nothing.
+void intervalTimer_start(uint32_t timerNumber) {
+  hostTimer_t *timer = &timers[timerNumber];
+  if (timer->running)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &timer->startTime);
+  timer->running = true;
+}
+
+// If the interval time is currently stopped, this function does nothing.
+void intervalTimer_stop(uint32_t timerNumber) {
+  hostTimer_t *timer = &timers[timerNumber];
+  struct timespec now;
+  if (!timer->running)
+    return;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  timer->totalSeconds += secondsBetween(&timer->startTime, &now);
+  timer->running = false;
+}
+
+// Stops the timer and zeroes its duration.
+void intervalTimer_reset(uint32_t timerNumber) {
+  timers[timerNumber] = (hostTimer_t){{0, 0}, 0.0, false};
+}
+
+// Simply calls intervalTimer_reset() on all timers.
+void intervalTimer_resetAll() {
+  for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    intervalTimer_reset(i);
+}
+
+// Includes the time since the last start if the timer is running.
+double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
+  hostTimer_t *timer = &timers[timerNumber];
+  struct timespec now;
+  if (!timer->running)
+    return timer->totalSeconds;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return timer->totalSeconds + secondsBetween(&timer->startTime, &now);
+}
+
+// Checks that the timer counts up while it runs and holds still once stopped.
+intervalTimer_status_t intervalTimer_test(uint32_t timerNumber) {
+  if (intervalTimer_init(timerNumber) != INTERVAL_TIMER_STATUS_OK)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  intervalTimer_start(timerNumber);
+  double running = intervalTimer_getTotalDurationInSeconds(timerNumber);
+  while (intervalTimer_getTotalDurationInSeconds(timerNumber) == running)
+    ;
+  intervalTimer_stop(timerNumber);
+  double stopped = intervalTimer_getTotalDurationInSeconds(timerNumber);
+  return (stopped > running &&
+          intervalTimer_getTotalDurationInSeconds(timerNumber) == stopped)
+             ? INTERVAL_TIMER_STATUS_OK
+             : INTERVAL_TIMER_STATUS_FAIL;
+}
+
+// Invokes intervalTimer_test() on all interval timers.
+intervalTimer_status_t intervalTimer_testAll() {
+  for (uint32_t i = 0; i < TIMER_COUNT; i++)
+    if (intervalTimer_test(i) != INTERVAL_TIMER_STATUS_OK)
+      return INTERVAL_TIMER_STATUS_FAIL;
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+// There is no LED on the host; the replay reports hits from the hit events.
+void hitLedTimer_start() {}
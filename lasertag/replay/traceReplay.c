@@ -0,0 +1,365 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Offline replay of recorded ADC traces through buffer.c, filter.c and
+// detector.c on the host, as fast as the CPU allows. The replay plays the
+// ISR: for each sample it ticks the lockout timer and pushes the sample into
+// the buffer (or adcCapture.c with -b), and every drain interval it runs the
+// detector the way the main loop does. Hits are printed with the index of the
+// sample that completed their decimated output, from the detector's hit
+// events, so the timestamps are exact to a sample. Each trace ends with its
+// throughput as a multiple of real time.
+//
+// The board starts the lockout timer at startup to hide the filters' settling
+// transient, which also hides any shot in the first 0.5 s. The replay instead
+// settles the filters on the trace's DC level before sample 0 with hits
+// ignored, so the whole trace is live.
+//
+// Build with "cmake -DREPLAY=1" at the top level, then run
+//   traceReplay [options] trace...
+// A trace holds the values interrupts_getAdcData() returns, in order, one per
+// 100 kHz tick: raw 16-bit little-endian samples by default, or one decimal
+// value per line with -t (blank lines and lines starting with # are skipped).
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adcCapture.h"
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "intervalTimer.h"
+#include "lockoutTimer.h"
+
+#define REPLAY_SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0)
+#define REPLAY_CHUNK_SIZE 4096 // Samples read from a trace at a time.
+#define REPLAY_DEFAULT_DRAIN_INTERVAL 1000 // Samples between detector runs.
+#define REPLAY_BLOCK_CAPTURE_CAPACITY                                          \
+  (ADC_CAPTURE_BLOCK_SIZE * ADC_CAPTURE_BLOCK_COUNT)
+#define REPLAY_TEXT_LINE_LENGTH 64
+// Samples of the trace's mean fed in before sample 0 to settle the filters;
+// as long as the startup lockout the board uses for the same purpose.
+#define REPLAY_PRIME_SAMPLE_COUNT LOCKOUT_TIMER_EXPIRE_VALUE
+#define TOTAL_TIMER INTERVAL_TIMER_TIMER_0    // Whole replay, reading included.
+#define DETECTOR_TIMER INTERVAL_TIMER_TIMER_1 // detector() calls only.
+
+// Priming must leave the decimation phase and the capture blocks where a
+// fresh start would, so that sample 0 of the trace is handled the same way.
+_Static_assert(REPLAY_PRIME_SAMPLE_COUNT % FILTER_FIR_DECIMATION_FACTOR == 0 &&
+                   REPLAY_PRIME_SAMPLE_COUNT % ADC_CAPTURE_BLOCK_SIZE == 0,
+               "priming must end on a decimated output and a block");
+
+typedef struct {
+  bool textTraces;            // -t: one decimal value per line.
+  bool blockCapture;          // -b: adcCapture.c and detector_runBlocks().
+  bool quiet;                 // -q: summaries only.
+  detector_hitMode_t hitMode; // -m: DETECTOR_HIT_MODE_MULTI.
+  uint32_t fudgeFactorIndex;  // -f N.
+  uint32_t drainInterval;     // -d N, in samples.
+  // -i N, repeatable.
+  bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+} replayOptions_t;
+
+// Reads samples from one trace file in either format.
+typedef struct {
+  FILE *file;
+  const char *name;
+  bool text;
+  uint64_t lineNumber; // Text traces, for error messages.
+  bool failed;         // A read or parse error ended the trace.
+} traceReader_t;
+
+// Counts of one replayed trace.
+typedef struct {
+  uint64_t sampleCount;
+  uint64_t hitEventCount;
+  double totalSeconds;
+  double detectorSeconds;
+} replayResult_t;
+
+static replayOptions_t options;
+
+// Prints the command-line help to stderr.
+static void printUsage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options] trace...\n"
+          "  -t    text traces, one ADC value per line (default: raw 16-bit\n"
+          "        little-endian samples)\n"
+          "  -b    block capture (adcCapture.c and detector_runBlocks())\n"
+          "  -m    multi-hit mode\n"
+          "  -f N  fudge-factor index (default 0)\n"
+          "  -i N  ignore frequency N, repeatable\n"
+          "  -d N  run the detector every N samples (default %d)\n"
+          "  -q    only print the summaries\n",
+          program, REPLAY_DEFAULT_DRAIN_INTERVAL);
+}
+
+// Parses a non-negative decimal number into *value. Returns false if text is
+// not one.
+static bool parseNumber(const char *text, uint32_t *value) {
+  char *end;
+  unsigned long number = strtoul(text, &end, 10);
+  if (end == text || *end != '\0' || text[0] == '-' || number > UINT32_MAX)
+    return false;
+  *value = number;
+  return true;
+}
+
+// Fills options from the command line and returns the index of the first
+// trace, or 0 if the command line is wrong.
+static int parseOptions(int argc, char *argv[]) {
+  options = (replayOptions_t){.hitMode = DETECTOR_HIT_MODE_SINGLE,
+                              .drainInterval = REPLAY_DEFAULT_DRAIN_INTERVAL};
+  int i = 1;
+  for (; i < argc && argv[i][0] == '-'; i++) {
+    const char *flag = argv[i];
+    uint32_t value = 0;
+    bool takesValue =
+        !strcmp(flag, "-f") || !strcmp(flag, "-i") || !strcmp(flag, "-d");
+    if (takesValue && (i + 1 == argc || !parseNumber(argv[++i], &value))) {
+      fprintf(stderr, "%s needs a number\n", flag);
+      return 0;
+    }
+    if (!strcmp(flag, "-t"))
+      options.textTraces = true;
+    else if (!strcmp(flag, "-b"))
+      options.blockCapture = true;
+    else if (!strcmp(flag, "-m"))
+      options.hitMode = DETECTOR_HIT_MODE_MULTI;
+    else if (!strcmp(flag, "-q"))
+      options.quiet = true;
+    else if (!strcmp(flag, "-f"))
+      options.fudgeFactorIndex = value;
+    else if (!strcmp(flag, "-i") && value < FILTER_FREQUENCY_COUNT)
+      options.ignoredFrequencies[value] = true;
+    else if (!strcmp(flag, "-d"))
+      options.drainInterval = value;
+    else {
+      fprintf(stderr, "unknown option or frequency: %s\n", flag);
+      return 0;
+    }
+  }
+  // Draining less often than this would lose samples before the detector
+  // gets to them.
+  uint32_t capacity =
+      options.blockCapture ? REPLAY_BLOCK_CAPTURE_CAPACITY : BUFFER_CAPACITY;
+  if (options.drainInterval == 0 || options.drainInterval > capacity) {
+    fprintf(stderr, "-d must be between 1 and %u samples\n", capacity);
+    return 0;
+  }
+  return i < argc ? i : 0;
+}
+
+// Reads up to maxCount samples into samples[] and returns how many were read;
+// 0 at the end of the trace or after an error, which sets reader->failed.
+static uint32_t readSamples(traceReader_t *reader, buffer_data_t samples[],
+                            uint32_t maxCount) {
+  uint32_t count = 0;
+  if (!reader->text) {
+    uint8_t bytes[REPLAY_CHUNK_SIZE * 2];
+    size_t byteCount = fread(bytes, 1, maxCount * 2, reader->file);
+    // Little-endian on any host.
+    for (; count < byteCount / 2; count++)
+      samples[count] = bytes[2 * count] | (bytes[2 * count + 1] << 8);
+    if (byteCount % 2)
+      fprintf(stderr, "%s: ignoring the odd byte at the end\n", reader->name);
+  } else {
+    char line[REPLAY_TEXT_LINE_LENGTH];
+    while (count < maxCount && fgets(line, sizeof(line), reader->file)) {
+      reader->lineNumber++;
+      line[strcspn(line, "\r\n")] = '\0';
+      uint32_t value;
+      if (line[0] == '\0' || line[0] == '#')
+        continue;
+      if (!parseNumber(line, &value) || value > UINT16_MAX) {
+        fprintf(stderr, "%s:%llu: not an ADC value: %s\n", reader->name,
+                (unsigned long long)reader->lineNumber, line);
+        reader->failed = true;
+        return 0;
+      }
+      samples[count++] = value;
+    }
+  }
+  if (ferror(reader->file)) {
+    perror(reader->name);
+    reader->failed = true;
+    return 0;
+  }
+  return count;
+}
+
+// Plays one ISR tick: ticks the lockout timer and hands the sample to the
+// buffer, or to adcCapture.c with -b. Same order as isr_function().
+static void pushSample(buffer_data_t sample) {
+  lockoutTimer_tick();
+  if (options.blockCapture)
+    adcCapture_tick(sample);
+  else
+    buffer_pushover(sample);
+}
+
+// Runs the detector over the samples pushed so far, like the main loop.
+static void drainSamples(void) {
+  if (options.blockCapture)
+    detector_runBlocks();
+  else
+    detector(true);
+}
+
+// Runs the detector over the samples the replay has pushed and prints the hit
+// events it recorded. sampleCount is the number of trace samples pushed so
+// far; the ticks also count the priming samples before them.
+static uint64_t runDetector(const char *traceName, uint64_t sampleCount) {
+  detector_hitEvent_t events[DETECTOR_HIT_EVENT_CAPACITY];
+  uint64_t eventCount = 0;
+  uint16_t count;
+  uint32_t tickCount = (uint32_t)(sampleCount + REPLAY_PRIME_SAMPLE_COUNT);
+  intervalTimer_start(DETECTOR_TIMER);
+  drainSamples();
+  intervalTimer_stop(DETECTOR_TIMER);
+  detector_clearHit();
+  while ((count = detector_takeHitEvents(events,
+                                         DETECTOR_HIT_EVENT_CAPACITY)) > 0) {
+    eventCount += count;
+    for (uint16_t i = 0; i < count && !options.quiet; i++) {
+      // Ticks wrap at 2^32 (about 12 hours); every event is newer than that.
+      uint64_t sample = sampleCount - (uint32_t)(tickCount - events[i].tick);
+      printf("%s: hit on frequency %u at sample %llu (%.5f s), power %.4g, "
+             "margin %.4g\n",
+             traceName, events[i].frequency, (unsigned long long)sample,
+             sample / REPLAY_SAMPLE_RATE_HZ, events[i].power,
+             events[i].thresholdMargin);
+    }
+  }
+  return eventCount;
+}
+
+// Resets the ISR-side modules and the detector for a new trace, from tick 0,
+// then settles the filters on REPLAY_PRIME_SAMPLE_COUNT copies of dcLevel with
+// hits ignored, so that their startup transient scores nothing and blinds
+// no part of the trace. The lockout timer is left stopped.
+static void initReplay(buffer_data_t dcLevel) {
+  buffer_init();
+  adcCapture_init();
+  lockoutTimer_init();
+  detector_init();
+  detector_setHitMode(options.hitMode);
+  detector_setFudgeFactorIndex(options.fudgeFactorIndex);
+  detector_setIgnoredFrequencies(options.ignoredFrequencies);
+  detector_ignoreAllHits(true);
+  for (uint32_t i = 1; i <= REPLAY_PRIME_SAMPLE_COUNT; i++) {
+    pushSample(dcLevel);
+    if (i % options.drainInterval == 0 || i == REPLAY_PRIME_SAMPLE_COUNT)
+      drainSamples();
+  }
+  detector_ignoreAllHits(false);
+  detector_clearHit();
+}
+
+// Returns the mean of samples[0] through samples[count - 1], count > 0.
+static buffer_data_t meanSample(const buffer_data_t samples[],
+                                uint32_t count) {
+  uint64_t sum = 0;
+  for (uint32_t i = 0; i < count; i++)
+    sum += samples[i];
+  return (sum + count / 2) / count;
+}
+
+// Replays one trace file and returns its counts. Returns false if the trace
+// cannot be read to the end.
+static bool replayTrace(const char *traceName, replayResult_t *result) {
+  buffer_data_t samples[REPLAY_CHUNK_SIZE];
+  traceReader_t reader = {fopen(traceName, options.textTraces ? "r" : "rb"),
+                          traceName, options.textTraces, 0, false};
+  if (!reader.file) {
+    perror(traceName);
+    return false;
+  }
+  *result = (replayResult_t){0, 0, 0.0, 0.0};
+  intervalTimer_reset(TOTAL_TIMER);
+  intervalTimer_reset(DETECTOR_TIMER);
+  intervalTimer_start(TOTAL_TIMER);
+  // The first chunk gives the DC level to settle the filters on; priming is
+  // not part of the timed replay.
+  uint32_t count = readSamples(&reader, samples, REPLAY_CHUNK_SIZE);
+  intervalTimer_stop(TOTAL_TIMER);
+  initReplay(count > 0 ? meanSample(samples, count) : 0);
+  intervalTimer_start(TOTAL_TIMER);
+  uint32_t sinceDrain = 0;
+  for (; count > 0; count = readSamples(&reader, samples, REPLAY_CHUNK_SIZE)) {
+    for (uint32_t i = 0; i < count; i++) {
+      pushSample(samples[i]);
+      result->sampleCount++;
+      if (++sinceDrain == options.drainInterval) {
+        result->hitEventCount += runDetector(traceName, result->sampleCount);
+        sinceDrain = 0;
+      }
+    }
+  }
+  // A partly filled capture block is never published, as on the board.
+  result->hitEventCount += runDetector(traceName, result->sampleCount);
+  intervalTimer_stop(TOTAL_TIMER);
+  result->totalSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_TIMER);
+  result->detectorSeconds =
+      intervalTimer_getTotalDurationInSeconds(DETECTOR_TIMER);
+  fclose(reader.file);
+  return !reader.failed;
+}
+
+// Prints the summary of one trace: how long the signal is, how long the
+// replay took, the hit counts and anything the replay lost.
+static void printSummary(const char *traceName, const replayResult_t *result) {
+  double signalSeconds = result->sampleCount / REPLAY_SAMPLE_RATE_HZ;
+  detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+  uint32_t lostSamples = options.blockCapture
+                             ? adcCapture_getDroppedSampleCount()
+                             : buffer_getStats().overwrittenCount;
+  printf("%s: %llu samples (%.2f s of signal) replayed in %.3f s, "
+         "%.1fx real time (detector alone %.1fx)\n",
+         traceName, (unsigned long long)result->sampleCount, signalSeconds,
+         result->totalSeconds, signalSeconds / result->totalSeconds,
+         signalSeconds / result->detectorSeconds);
+  detector_getHitCounts(hitCounts);
+  printf("%s: %llu hit events, hits per frequency:", traceName,
+         (unsigned long long)result->hitEventCount);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    printf(" %u", hitCounts[i]);
+  printf("\n");
+  if (detector_getDroppedHitEventCount() || lostSamples)
+    printf("%s: * Warning: %u hit events and %u samples dropped\n", traceName,
+           detector_getDroppedHitEventCount(), lostSamples);
+}
+
+int main(int argc, char *argv[]) {
+  int firstTrace = parseOptions(argc, argv);
+  replayResult_t result, total = {0, 0, 0.0, 0.0};
+  bool allReplayed = true;
+  if (firstTrace == 0) {
+    printUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  intervalTimer_initAll();
+  for (int i = firstTrace; i < argc; i++) {
+    if (!replayTrace(argv[i], &result)) {
+      allReplayed = false;
+      continue;
+    }
+    printSummary(argv[i], &result);
+    total.sampleCount += result.sampleCount;
+    total.totalSeconds += result.totalSeconds;
+  }
+  if (argc - firstTrace > 1 && total.totalSeconds > 0.0)
+    printf("all traces: %.2f s of signal in %.3f s, %.1fx real time\n",
+           total.sampleCount / REPLAY_SAMPLE_RATE_HZ, total.totalSeconds,
+           total.sampleCount / REPLAY_SAMPLE_RATE_HZ / total.totalSeconds);
+  return allReplayed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,26 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SPSC_H_
+#define SPSC_H_
+
+// Accessors for the counts and indices of the single-producer/single-consumer
+// rings (buffer, adcCapture, the detector's hit events). Each count is written
+// by one side only. A side stores its count with SPSC_STORE() after it is done
+// with the slots the count covers, and the other side loads it with
+// SPSC_LOAD() before it touches those slots, so neither side masks
+// interrupts. The owner of a count may read it with a plain load.
+
+// Loads var with acquire ordering.
+#define SPSC_LOAD(var) __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+
+// Stores value to var with release ordering.
+#define SPSC_STORE(var, value) __atomic_store_n(&(var), (value), __ATOMIC_RELEASE)
+
+#endif /* SPSC_H_ */
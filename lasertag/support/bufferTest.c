@@ -11,9 +11,11 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdio.h>
 
 #include "buffer.h"
+#include "adcCapture.h"
 
 #define MAX_ERROR_CNT 5
-#define MARK(n) (n^0x8000)
+#define MARK(n) (((n)^0x8000) & BUFFER_VALUE_MASK)
+#define POP_MANY_BLOCK_SIZE 100 // Does not divide the buffer size.
 
 static uint32_t error_cnt;
 
@@ -28,9 +30,21 @@ static void check_value(buffer_data_t expected)
 	}
 }
 
+// Compares a value returned by buffer_popMany().
+static void check_block_value(buffer_data_t found, buffer_data_t expected)
+{
+	if (expected != found) {
+		if (error_cnt < MAX_ERROR_CNT)
+			printf(" -- error: expected: 0x%08X, found: 0x%08X\n", expected, found);
+		error_cnt++;
+	}
+}
+
 void buffer_runTest(void)
 {
-	uint32_t i, bsize, start;
+	uint32_t i, j, n, bsize, start;
+	static buffer_data_t block[POP_MANY_BLOCK_SIZE];
+	buffer_stats_t stats;
 
 	buffer_init();
 	bsize = buffer_size();
@@ -73,4 +87,143 @@ void buffer_runTest(void)
 	check_value(0);
 	check_value(0);
 	printf("errors: %d\n", error_cnt);
+
+	printf("popMany across the wrap test\n");
+	start = 0x60;
+	error_cnt = 0;
+	for (i = start; i < start+bsize/2; i++) buffer_pushover(MARK(i));
+	for (i = start; i < start+bsize/2; i++) check_value(MARK(i));
+	for (i = start; i < start+bsize; i++) buffer_pushover(MARK(i));
+	i = start;
+	while ((n = buffer_popMany(block, POP_MANY_BLOCK_SIZE)) > 0)
+		for (j = 0; j < n; j++, i++) check_block_value(block[j], MARK(i));
+	if (i != start+bsize) {
+		printf(" -- error: popMany returned %d values, expected %d\n", i-start, bsize);
+		error_cnt++;
+	}
+	printf("errors: %d\n", error_cnt);
+
+	printf("over-fill and popMany test\n");
+	start = 0x70;
+	error_cnt = 0;
+	for (i = start; i < start+bsize+3; i++) buffer_pushover(MARK(i));
+	if (buffer_elements() != bsize) {
+		printf(" -- error: %d elements after over-fill, expected %d\n", buffer_elements(), bsize);
+		error_cnt++;
+	}
+	i = start+3;
+	while ((n = buffer_popMany(block, POP_MANY_BLOCK_SIZE)) > 0)
+		for (j = 0; j < n; j++, i++) check_block_value(block[j], MARK(i));
+	if (i != start+bsize+3 || buffer_popMany(block, 1) != 0) {
+		printf(" -- error: popMany did not drain the buffer exactly\n");
+		error_cnt++;
+	}
+	printf("errors: %d\n", error_cnt);
+
+	printf("popBlock test\n");
+	start = 0x80;
+	error_cnt = 0;
+	for (i = start; i < start+POP_MANY_BLOCK_SIZE*3/2; i++) buffer_pushover(MARK(i));
+	if (!buffer_popBlock(block, POP_MANY_BLOCK_SIZE)) {
+		printf(" -- error: popBlock failed with a whole block buffered\n");
+		error_cnt++;
+	}
+	for (j = 0; j < POP_MANY_BLOCK_SIZE; j++) check_block_value(block[j], MARK(start+j));
+	if (buffer_popBlock(block, POP_MANY_BLOCK_SIZE) || buffer_elements() != POP_MANY_BLOCK_SIZE/2) {
+		printf(" -- error: popBlock removed a partial block\n");
+		error_cnt++;
+	}
+	for (i = start+POP_MANY_BLOCK_SIZE; i < start+POP_MANY_BLOCK_SIZE*3/2; i++) check_value(MARK(i));
+	printf("errors: %d\n", error_cnt);
+
+	printf("stats test\n");
+	buffer_init();
+	start = 0x90;
+	error_cnt = 0;
+	for (i = start; i < start+bsize/2; i++) buffer_pushover(MARK(i));
+	for (i = start; i < start+bsize/4; i++) check_value(MARK(i));
+	stats = buffer_getStats();
+	if (stats.overwrittenCount != 0 || stats.highWaterMark != bsize/2 ||
+	    stats.maxOldestValueAge != bsize/2 || stats.oldestValueAge != bsize/4) {
+		printf(" -- error: stats wrong before over-fill\n");
+		error_cnt++;
+	}
+	for (i = start+bsize/2; i < start+bsize*2; i++) buffer_pushover(MARK(i));
+	stats = buffer_getStats();
+	if (stats.overwrittenCount != bsize*3/4 || stats.highWaterMark != bsize ||
+	    stats.oldestValueAge != bsize) {
+		printf(" -- error: stats wrong after over-fill\n");
+		error_cnt++;
+	}
+	for (i = start+bsize; i < start+bsize*2; i++) check_value(MARK(i));
+	stats = buffer_getStats();
+	// Every push lands in one bin; the over-fill pushes land in the last one.
+	n = 0;
+	for (j = 0; j < BUFFER_STATS_HISTOGRAM_BIN_COUNT; j++) n += stats.occupancyHistogram[j];
+	if (n != stats.pushCount || stats.pushCount != bsize*2 ||
+	    stats.occupancyHistogram[BUFFER_STATS_HISTOGRAM_BIN_COUNT-1] < stats.overwrittenCount ||
+	    stats.maxOldestValueAge != bsize || stats.oldestValueAge != 0) {
+		printf(" -- error: stats wrong after drain\n");
+		error_cnt++;
+	}
+	printf("errors: %d\n", error_cnt);
+}
+
+// Checks that a ready block holds MARK(firstSample) onwards and was stamped
+// with firstTick, then releases it.
+static void check_block(uint32_t firstSample, uint32_t firstTick)
+{
+	const adcCapture_block_t *block = adcCapture_getReadyBlock();
+	uint32_t i;
+
+	if (block == NULL) {
+		printf(" -- error: no ready block, expected one starting at tick %d\n", firstTick);
+		error_cnt++;
+		return;
+	}
+	if (block->firstTick != firstTick) {
+		printf(" -- error: block stamped %d, expected %d\n", block->firstTick, firstTick);
+		error_cnt++;
+	}
+	for (i = 0; i < ADC_CAPTURE_BLOCK_SIZE; i++)
+		check_block_value(block->samples[i], MARK(firstSample+i));
+	adcCapture_releaseBlock();
+}
+
+void adcCapture_runTest(void)
+{
+	uint32_t i, tick;
+
+	printf("block capture test\n");
+	adcCapture_init();
+	error_cnt = 0;
+	for (i = 0; i < ADC_CAPTURE_BLOCK_SIZE*5/2; i++) adcCapture_tick(MARK(i));
+	if (adcCapture_readyBlockCount() != 2) {
+		printf(" -- error: %d ready blocks, expected 2\n", adcCapture_readyBlockCount());
+		error_cnt++;
+	}
+	check_block(0, 0);
+	check_block(ADC_CAPTURE_BLOCK_SIZE, ADC_CAPTURE_BLOCK_SIZE);
+	if (adcCapture_getReadyBlock() != NULL) {
+		printf(" -- error: a partial block was published\n");
+		error_cnt++;
+	}
+	printf("errors: %d\n", error_cnt);
+
+	printf("block capture overrun test\n");
+	adcCapture_init();
+	error_cnt = 0;
+	// Fill every block, then tick one more block's worth: those are dropped.
+	for (i = 0; i < ADC_CAPTURE_BLOCK_SIZE*(ADC_CAPTURE_BLOCK_COUNT+1); i++) adcCapture_tick(MARK(i));
+	if (adcCapture_getDroppedSampleCount() != ADC_CAPTURE_BLOCK_SIZE) {
+		printf(" -- error: %d samples dropped, expected %d\n", adcCapture_getDroppedSampleCount(), ADC_CAPTURE_BLOCK_SIZE);
+		error_cnt++;
+	}
+	check_block(0, 0);
+	// The freed block is refilled from the next tick on.
+	tick = adcCapture_getTickCount();
+	for (i = tick; i < tick+ADC_CAPTURE_BLOCK_SIZE; i++) adcCapture_tick(MARK(i));
+	for (i = 1; i < ADC_CAPTURE_BLOCK_COUNT; i++) check_block(i*ADC_CAPTURE_BLOCK_SIZE, i*ADC_CAPTURE_BLOCK_SIZE);
+	check_block(tick, tick);
+	printf("errors: %d\n", error_cnt);
 }
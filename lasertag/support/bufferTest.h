@@ -13,4 +13,8 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Tests for proper function of the buffer module.
 void buffer_runTest(void);
 
+// Tests the block-capture ring in adcCapture.c by calling adcCapture_tick()
+// directly, as the ISR would.
+void adcCapture_runTest(void);
+
 #endif /* BUFFERTEST_H_ */
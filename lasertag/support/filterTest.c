@@ -22,13 +22,16 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #ifdef ADC_THROUGH_DETECTOR
 #include "detector.h"
 #include "buffer.h"
+#endif
 #define ADC_INTEGER_MIN_VALUE 0
 #define ADC_INTEGER_MAX_VALUE 4095
-#endif
 
 #include "queue.h"
 #include "filter.h"
+#include "filterFixed.h"
+#include "goertzel.h"
 #include "histogram.h"
+#include "intervalTimer.h"
 #include "utils.h"
 
 /*******************************************************************************
@@ -314,21 +317,19 @@ double computeFilterInput(uint16_t freqTick, uint16_t currentPeriodTickCount) {
   return filterValue;
 }
 
-#ifdef ADC_THROUGH_DETECTOR
 // When performing a complete system test, the input goes to the ADC buffer and
-// must be computed accordingly.
+// must be computed accordingly. Also used by the Goertzel test.
 buffer_data_t computeAdcBufferInput(uint16_t freqTick,
                                uint16_t currentPeriodTickCount) {
   buffer_data_t adcValue;
   //  if (freqTick < currentPeriodTickCount/2)// The period has two halves: the
   //  -1.0 part and the 1.0 part.
-  if (freqTick < ONE_HALF(currentPeriodTickCount)// The period has two halves: the -1.0 part and the 1.0 part.
+  if (freqTick < ONE_HALF(currentPeriodTickCount)) // The period has two halves: the -1.0 part and the 1.0 part.
       adcValue = ADC_INTEGER_MIN_VALUE; // The first half of the period is a minimum value.
   else
     adcValue = ADC_INTEGER_MAX_VALUE; // The second half of the period is a maximum value.
   return adcValue;
 }
-#endif
 
 #define PLOT_VALUE_MAX_COUNT                                                   \
   360 // You can collect up to this many values to plot.
@@ -509,10 +510,7 @@ void filterTest_plotIirFrequencyResponse(double iirPowerValues[],
 
 // Fills the queue with the fillValue, overwriting all previous contents.
 void filterTest_fillQueue(queue_t *q, queue_data_t fillValue) {
-  queue_size_t n = queue_size(q);
-  for (queue_index_t i = 0; i < n; i++) {
-    queue_overwritePush(q, fillValue);
-  }
+  queue_fill(q, fillValue);
 }
 
 #define FILTER_IIR_POWER_TEST_PERIOD_COUNT FILTER_FREQUENCY_COUNT
@@ -543,7 +541,7 @@ void filterTest_runSquareWaveIirPowerTest(uint16_t filterNumber,
   for (uint16_t testPeriodIndex = 0; testPeriodIndex < FILTER_FREQUENCY_COUNT;
        testPeriodIndex++) { // Only use the first 10 standard frequencies.
     double power = 0.0;
-    filterTest_fillQueue(filter_getXQueue(), 0.0); // zero out the x-queue.
+    fir_fill(filter_getFir(), 0.0); // zero out the FIR input history.
     filterTest_fillQueue(filter_getYQueue(), 0.0); // zero out the y-queue.
     filterTest_fillQueue(
         filter_getZQueue(filterNumber),
@@ -605,19 +603,19 @@ void filterTest_runSquareWaveIirPowerTest(uint16_t filterNumber,
       testPeriodPowerValue, filterNumber); // Finally, plot the results.
 }
 
-// Pushes a single 1.0 through the xQueue. Golden output data are just the FIR
-// coefficients in reverse order. If this test passes, you are multiplying the
-// coefficient with the correct element of xQueue. This is equivalent to passing
-// the filter over an input containing only a delta function and thus returns
-// the impulse response.
+// Pushes a single 1.0 through the FIR history. Golden output data are just the
+// FIR coefficients in reverse order. If this test passes, you are multiplying
+// the coefficient with the correct element of the history. This is equivalent
+// to passing the filter over an input containing only a delta function and
+// thus returns the impulse response.
 bool filterTest_runFirAlignmentTest(bool printMessageFlag) {
   if (!filterTest_initFlag) {
     printf("Must call filterTest_init() before running any filter tests.\n");
     return false;
   }
   bool success = true;                           // Be optimistic.
-  filterTest_fillQueue(filter_getXQueue(), 0.0); // zero-out the xQueue.
-  filter_addNewInput(1.0); // Place a single 1.0 in the xQueue.
+  fir_fill(filter_getFir(), 0.0); // zero-out the FIR input history.
+  filter_addNewInput(1.0); // Place a single 1.0 in the FIR input history.
   for (uint32_t i = 0; i < filter_getFirCoefficientCount();
        i++) { // Push the single 1.0 through the queue.
     double firValue = filter_firFilter(); // Run the FIR filter.
@@ -647,8 +645,8 @@ bool filterTest_runFirAlignmentTest(bool printMessageFlag) {
   return success; // Return the success of failure of this test.
 }
 
-// Pushes a series of 1.0 values though xQueue. Golden output data is the sum of
-// the coefficients in reverse order. The FIR-filter is probably computing
+// Pushes a series of 1.0 values though the FIR history. Golden output data is
+// the sum of the coefficients in reverse order. The FIR-filter is probably computing
 // outputs correctly if you pass this test.
 bool filterTest_runFirArithmeticTest(bool printMessageFlag) {
   if (!filterTest_initFlag) {
@@ -656,14 +654,14 @@ bool filterTest_runFirArithmeticTest(bool printMessageFlag) {
     return false;
   }
   bool success = true;                       // Be optimistic.
-  filterTest_fillQueue(filter_getXQueue(), 0.0); // zero-out the xQueue.
+  fir_fill(filter_getFir(), 0.0); // zero-out the FIR input history.
   double firGoldenOutput =
       0.0; // You will compute the golden output by accumulating the FIR
            // coefficients in reverse order.
   for (uint32_t i = 0; i < filter_getFirCoefficientCount();
        i++) { // Loop enough times to go through the coefficients.
-    double newTestInput = 1.0;            // Only value in the xQueue is 1.0.
-    filter_addNewInput(newTestInput);     // Add a 1.0 in the xQueue.
+    double newTestInput = 1.0;            // Only value in the history is 1.0.
+    filter_addNewInput(newTestInput);     // Add a 1.0 to the FIR history.
     double firValue = filter_firFilter(); // Run the FIR filter.
     firGoldenOutput +=
         newTestInput *
@@ -950,6 +948,1006 @@ bool filterTest_runPowerTest(void) {
   return firstComputeStatus & incrementalComputeStatus;
 }
 
+// Tolerances for the fixed-point pipeline, measured against the double path.
+// FIR: absolute error. Q15 rounding of the 81 coefficients alone is worth up
+// to 81 * 2^-16 on a full-scale input, typically ~2.5e-4 on square waves.
+#define FIXED_POINT_FIR_TOLERANCE 1.0E-3
+// IIR: absolute error divided by the largest IIR output of the run.
+#define FIXED_POINT_IIR_RELATIVE_TOLERANCE 1.0E-3
+// Power: absolute error divided by the largest channel power of the run.
+#define FIXED_POINT_POWER_RELATIVE_TOLERANCE 1.0E-3
+// Runs the same square waves through filter.c and filterFixed.c and compares
+// the FIR outputs, all 10 IIR outputs and the final power values. Needs the
+// double build: with FILTER_FIXED_POINT defined both paths are the same code.
+bool filterTest_runFixedPointAccuracyTest(bool printMessageFlag) {
+  if (!filterTest_initFlag) {
+    printf("Must call filterTest_init() before running any filter tests.\n");
+    return false;
+  }
+#ifdef FILTER_FIXED_POINT
+  printf("filterTest_runFixedPointAccuracyTest skipped: filter.c is built "
+         "with FILTER_FIXED_POINT.\n");
+  return true;
+#endif
+  bool success = true; // Be optimistic.
+  double worstFirError = 0.0;
+  double worstIirError = 0.0;
+  double worstPowerError = 0.0;
+  for (uint16_t testPeriodIndex = 0; testPeriodIndex < FILTER_FREQUENCY_COUNT;
+       testPeriodIndex++) {
+    filter_init();
+    filterFixed_init();
+    firDecimationCount = 0;
+    uint16_t currentPeriodTickCount =
+        filterTest_firTestTickCounts[testPeriodIndex];
+    double maxIirOutput = 0.0;
+    double maxIirError = 0.0;
+    uint32_t totalTickCount = 0;
+    while (totalTickCount < FILTER_TEST_PULSE_WIDTH_LENGTH) {
+      for (uint16_t freqTick = 0; freqTick < currentPeriodTickCount;
+           freqTick++) {
+        double filterValue = computeFilterInput(freqTick, currentPeriodTickCount);
+        filter_addNewInput(filterValue);
+        filterFixed_addNewInput(filterFixed_fromDouble(filterValue));
+        if (filterTest_decimatingFirFilter()) { // Ran the double FIR.
+          double firFixed = filterFixed_signalToDouble(filterFixed_firFilter());
+          double firError = fabs(
+              filterTest_readMostRecentValueFromQueue(filter_getYQueue()) -
+              firFixed);
+          if (firError > worstFirError)
+            worstFirError = firError;
+          for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+            double iirDouble = filter_iirFilter(i);
+            double iirFixed =
+                filterFixed_signalToDouble(filterFixed_iirFilter(i));
+            if (fabs(iirDouble) > maxIirOutput)
+              maxIirOutput = fabs(iirDouble);
+            if (fabs(iirDouble - iirFixed) > maxIirError)
+              maxIirError = fabs(iirDouble - iirFixed);
+          }
+        }
+        totalTickCount++;
+      }
+    }
+    if (maxIirOutput > 0.0 && maxIirError / maxIirOutput > worstIirError)
+      worstIirError = maxIirError / maxIirOutput;
+    // Compare the power values once the output windows are full.
+    double maxPower = 0.0;
+    double powerDouble[FILTER_FREQUENCY_COUNT];
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      powerDouble[i] = filter_computePower(i, true, false);
+      if (powerDouble[i] > maxPower)
+        maxPower = powerDouble[i];
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT && maxPower > 0.0; i++) {
+      double powerFixed =
+          filterFixed_powerToDouble(filterFixed_computePower(i, true));
+      double powerError = fabs(powerDouble[i] - powerFixed) / maxPower;
+      if (powerError > worstPowerError)
+        worstPowerError = powerError;
+    }
+  }
+  success &= worstFirError < FIXED_POINT_FIR_TOLERANCE;
+  success &= worstIirError < FIXED_POINT_IIR_RELATIVE_TOLERANCE;
+  success &= worstPowerError < FIXED_POINT_POWER_RELATIVE_TOLERANCE;
+  // Print informational messages.
+  if (printMessageFlag || !success) {
+    printf("fixed-point vs double: FIR error %le (limit %le), IIR relative "
+           "error %le (limit %le), power relative error %le (limit %le)\n",
+           worstFirError, FIXED_POINT_FIR_TOLERANCE, worstIirError,
+           FIXED_POINT_IIR_RELATIVE_TOLERANCE, worstPowerError,
+           FIXED_POINT_POWER_RELATIVE_TOLERANCE);
+    printf("filterTest_runFixedPointAccuracyTest ");
+    if (success)
+      printf("passed.\n");
+    else
+      printf("failed.\n");
+  }
+  filter_init(); // Leave the filters in a known state for the other tests.
+  return success;
+}
+
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_1
+#define BENCHMARK_SAMPLE_COUNT 200000 // Two seconds worth of ADC samples.
+// Runs the complete per-sample work of the detector (FIR input, decimated FIR,
+// 10 IIR filters and incremental power) on both pipelines and prints the
+// throughput in input samples per second. The ADC delivers 100,000.
+void filterTest_runFixedPointBenchmark(void) {
+  intervalTimer_init(BENCHMARK_TIMER);
+
+  filter_init();
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < BENCHMARK_SAMPLE_COUNT; i++) {
+    filter_addNewInput(computeFilterInput(i % filter_frequencyTickTable[0],
+                                          filter_frequencyTickTable[0]));
+    if (i % FILTER_FIR_DECIMATION_FACTOR == 0) {
+      filter_firFilter();
+      for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        filter_iirFilter(j);
+        filter_computePower(j, false, false);
+      }
+    }
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double doubleSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+  filterFixed_init();
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < BENCHMARK_SAMPLE_COUNT; i++) {
+    filterFixed_addNewInput(filterFixed_fromDouble(computeFilterInput(
+        i % filter_frequencyTickTable[0], filter_frequencyTickTable[0])));
+    if (i % FILTER_FIR_DECIMATION_FACTOR == 0) {
+      filterFixed_firFilter();
+      for (uint16_t j = 0; j < FILTER_FREQUENCY_COUNT; j++) {
+        filterFixed_iirFilter(j);
+        filterFixed_computePower(j, false);
+      }
+    }
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double fixedSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+  printf("filter pipeline benchmark over %d samples:\n", BENCHMARK_SAMPLE_COUNT);
+  printf("  double:      %.0f samples/second\n",
+         BENCHMARK_SAMPLE_COUNT / doubleSeconds);
+  printf("  fixed-point: %.0f samples/second\n",
+         BENCHMARK_SAMPLE_COUNT / fixedSeconds);
+  filter_init();
+}
+
+#define FIR_BENCHMARK_OUTPUT_COUNT 20000 // Two seconds worth of FIR outputs.
+// Computes the FIR output the way filter_firFilter() did before fir.c existed:
+// one queue_readElementAt() call per tap. Used as the benchmark baseline.
+static double filterTest_queueFirFilter(queue_t *q, const double b[],
+                                        uint32_t tapCount) {
+  double y = 0.0;
+  for (uint32_t i = 0; i < tapCount; i++)
+    y += queue_readElementAt(q, tapCount - 1 - i) * b[i];
+  return y;
+}
+
+// Feeds the same random inputs to the queue-based FIR and to the mirrored
+// history in fir.c, unfolded and folded, checks that all three produce the
+// same outputs and prints the speedup of each kernel. Returns false if the
+// outputs differ.
+bool filterTest_runFirKernelBenchmark(void) {
+  const double *b = filter_getFirCoefficientArray();
+  uint32_t tapCount = filter_getFirCoefficientCount();
+  static queue_t xQueue;
+  static fir_t testFir;
+  static double inputs[FIR_BENCHMARK_OUTPUT_COUNT];
+  queue_init(&xQueue, tapCount, "benchmarkXQueue");
+  filterTest_fillQueue(&xQueue, 0.0);
+  fir_init(&testFir, b, tapCount);
+  for (uint32_t i = 0; i < FIR_BENCHMARK_OUTPUT_COUNT; i++)
+    inputs[i] = 2.0 * filterTest_randomValue0To1() - 1.0;
+  intervalTimer_init(BENCHMARK_TIMER);
+
+  // Baseline: queue_readElementAt() per tap.
+  double queueSum = 0.0;
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < FIR_BENCHMARK_OUTPUT_COUNT; i++) {
+    queue_overwritePush(&xQueue, inputs[i]);
+    queueSum += filterTest_queueFirFilter(&xQueue, b, tapCount);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double queueSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+  // Mirrored linear history and SIMD dot product.
+  double kernelSum = 0.0;
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < FIR_BENCHMARK_OUTPUT_COUNT; i++) {
+    fir_addNewInput(&testFir, inputs[i]);
+    kernelSum += fir_compute(&testFir);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double kernelSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+  // Same history, forced through the unfolded 81-multiply dot product.
+  double unfoldedSum = 0.0;
+  fir_fill(&testFir, 0.0);
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < FIR_BENCHMARK_OUTPUT_COUNT; i++) {
+    fir_addNewInput(&testFir, inputs[i]);
+    unfoldedSum += fir_dotProduct(fir_window(&testFir),
+                                  testFir.reversedCoefficients, tapCount);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double unfoldedSeconds =
+      intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+  queue_garbageCollect(&xQueue);
+
+  // The kernel adds in a different order, so allow for rounding differences.
+  double tolerance =
+      TEST_FILTER_FLOATING_POINT_EPSILON * FIR_BENCHMARK_OUTPUT_COUNT;
+  bool success = fabs(queueSum - kernelSum) < tolerance &&
+                 fabs(queueSum - unfoldedSum) < tolerance;
+  printf("FIR kernel benchmark over %d outputs:\n", FIR_BENCHMARK_OUTPUT_COUNT);
+  printf("  queue_readElementAt: %.0f outputs/second\n",
+         FIR_BENCHMARK_OUTPUT_COUNT / queueSeconds);
+  printf("  mirrored history:    %.0f outputs/second (%.1fx)\n",
+         FIR_BENCHMARK_OUTPUT_COUNT / unfoldedSeconds,
+         queueSeconds / unfoldedSeconds);
+  printf("  folded:              %.0f outputs/second (%.1fx)\n",
+         FIR_BENCHMARK_OUTPUT_COUNT / kernelSeconds,
+         queueSeconds / kernelSeconds);
+  if (!success)
+    printf("filterTest_runFirKernelBenchmark: outputs differ (%le, %le, %le).\n",
+           queueSum, unfoldedSum, kernelSum);
+  return success;
+}
+
+#define FOLDED_FIR_TEST_OUTPUT_COUNT 5000
+// The folded kernel adds x[i] + x[80 - i] before multiplying, so its rounding
+// differs from the tap-by-tap sum. For inputs in [-1, 1] both sums are within
+// 81 * 2^-53 * sum(|b|) of the exact value, about 1.2e-14 for the lowpass.
+#define FOLDED_FIR_TOLERANCE 1.0E-13
+// Checks that the lowpass coefficients are detected as symmetric and that a
+// perturbed copy is not, then feeds random inputs through filter_firFilter()
+// and compares every output against the tap-by-tap queue-based FIR.
+bool filterTest_runFoldedFirTest(bool printMessageFlag) {
+  const double *b = filter_getFirCoefficientArray();
+  uint32_t tapCount = filter_getFirCoefficientCount();
+  static double asymmetric[FIR_MAX_TAP_COUNT];
+  static fir_t asymmetricFir;
+  static queue_t xQueue;
+  bool success = true;
+  if (!fir_isSymmetric(filter_getFir())) {
+    printf("filterTest_runFoldedFirTest: FIR coefficients not detected as "
+           "symmetric.\n");
+    success = false;
+  }
+  for (uint32_t i = 0; i < tapCount; i++)
+    asymmetric[i] = b[i];
+  asymmetric[0] += TEST_FILTER_FLOATING_POINT_EPSILON;
+  fir_init(&asymmetricFir, asymmetric, tapCount);
+  if (fir_isSymmetric(&asymmetricFir)) {
+    printf("filterTest_runFoldedFirTest: asymmetric coefficients detected as "
+           "symmetric.\n");
+    success = false;
+  }
+#ifdef FILTER_FIXED_POINT
+  printf("filterTest_runFoldedFirTest: output check skipped, filter.c is built "
+         "with FILTER_FIXED_POINT.\n");
+  return success;
+#endif
+
+  queue_init(&xQueue, tapCount, "foldedTestXQueue");
+  filterTest_fillQueue(&xQueue, 0.0);
+  fir_fill(filter_getFir(), 0.0);
+  double maxError = 0.0;
+  for (uint32_t i = 0; i < FOLDED_FIR_TEST_OUTPUT_COUNT; i++) {
+    double x = 2.0 * filterTest_randomValue0To1() - 1.0;
+    queue_overwritePush(&xQueue, x);
+    filter_addNewInput(x);
+    double error = fabs(filter_firFilter() -
+                        filterTest_queueFirFilter(&xQueue, b, tapCount));
+    if (error > maxError)
+      maxError = error;
+  }
+  queue_garbageCollect(&xQueue);
+  fir_fill(filter_getFir(), 0.0);
+
+  success &= maxError <= FOLDED_FIR_TOLERANCE;
+  if (printMessageFlag || !success)
+    printf("filterTest_runFoldedFirTest: max error %le (tolerance %le).\n",
+           maxError, FOLDED_FIR_TOLERANCE);
+  printf("filterTest_runFoldedFirTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+#define PROCESS_BLOCK_TEST_SAMPLE_COUNT 100000 // One second of ADC samples.
+#define PROCESS_BLOCK_TEST_OUTPUT_COUNT                                        \
+  (PROCESS_BLOCK_TEST_SAMPLE_COUNT / FILTER_FIR_DECIMATION_FACTOR)
+#define PROCESS_BLOCK_TEST_ADC_MIDSCALE 2047.5 // Same scaling as filter.c.
+#define PROCESS_BLOCK_TEST_ADC_MAX_VALUE 4095
+// Block sizes cycled through by the test, chosen to straddle the decimation
+// factor and the FIR_DECIMATE_CHUNK_SIZE chunking in fir.c.
+static const uint32_t processBlockTestSizes[] = {1, 7, 10, 33, 100, 129, 250};
+#define PROCESS_BLOCK_TEST_SIZE_COUNT                                          \
+  (sizeof(processBlockTestSizes) / sizeof(processBlockTestSizes[0]))
+// Runs the same random ADC samples through filter_addNewInput() and
+// filter_firFilter() on every FILTER_FIR_DECIMATION_FACTOR-th sample, then
+// through filter_processBlock() in blocks of assorted sizes. Both paths run
+// the same kernel over the same windows, so the outputs must match exactly.
+// Also prints the throughput of both paths.
+bool filterTest_runProcessBlockTest(bool printMessageFlag) {
+#ifdef FILTER_FIXED_POINT
+  printf("filterTest_runProcessBlockTest skipped: filter.c is built with "
+         "FILTER_FIXED_POINT.\n");
+  return true;
+#endif
+  static buffer_data_t adc[PROCESS_BLOCK_TEST_SAMPLE_COUNT];
+  static double sampleOutputs[PROCESS_BLOCK_TEST_OUTPUT_COUNT];
+  static double blockOutputs[PROCESS_BLOCK_TEST_OUTPUT_COUNT];
+  for (uint32_t i = 0; i < PROCESS_BLOCK_TEST_SAMPLE_COUNT; i++)
+    adc[i] = (buffer_data_t)(filterTest_randomValue0To1() *
+                             PROCESS_BLOCK_TEST_ADC_MAX_VALUE);
+  intervalTimer_init(BENCHMARK_TIMER);
+
+  // Per-sample path, decimating by hand.
+  filter_init();
+  uint32_t sampleOutputCount = 0;
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < PROCESS_BLOCK_TEST_SAMPLE_COUNT; i++) {
+    filter_addNewInput(((double)adc[i] - PROCESS_BLOCK_TEST_ADC_MIDSCALE) *
+                       (1.0 / PROCESS_BLOCK_TEST_ADC_MIDSCALE));
+    if ((i + 1) % FILTER_FIR_DECIMATION_FACTOR == 0)
+      sampleOutputs[sampleOutputCount++] = filter_firFilter();
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double sampleSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+  // Block path.
+  filter_init();
+  uint32_t blockOutputCount = 0;
+  uint32_t consumed = 0;
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t k = 0; consumed < PROCESS_BLOCK_TEST_SAMPLE_COUNT; k++) {
+    uint32_t n = processBlockTestSizes[k % PROCESS_BLOCK_TEST_SIZE_COUNT];
+    if (n > PROCESS_BLOCK_TEST_SAMPLE_COUNT - consumed)
+      n = PROCESS_BLOCK_TEST_SAMPLE_COUNT - consumed;
+    blockOutputCount += filter_processBlock(&adc[consumed], n,
+                                            &blockOutputs[blockOutputCount]);
+    consumed += n;
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double blockSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+  filter_init();
+
+  bool success = sampleOutputCount == blockOutputCount;
+  uint32_t mismatchCount = 0;
+  for (uint32_t i = 0; success && i < sampleOutputCount; i++)
+    if (sampleOutputs[i] != blockOutputs[i])
+      mismatchCount++;
+  success &= mismatchCount == 0;
+  if (printMessageFlag || !success) {
+    printf("filterTest_runProcessBlockTest: %d vs %d outputs, %d mismatches.\n",
+           sampleOutputCount, blockOutputCount, mismatchCount);
+    printf("  per-sample: %.0f samples/second\n",
+           PROCESS_BLOCK_TEST_SAMPLE_COUNT / sampleSeconds);
+    printf("  block:      %.0f samples/second (%.1fx)\n",
+           PROCESS_BLOCK_TEST_SAMPLE_COUNT / blockSeconds,
+           sampleSeconds / blockSeconds);
+  }
+  printf("filterTest_runProcessBlockTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+#define IIR_B_COEFFICIENT_COUNT_MAX 11 // Sizes the direct-form history.
+#define BIQUAD_TEST_OUTPUT_COUNT 10000 // One second of decimated outputs.
+// Single-precision rounding inside the resonant sections, measured as the
+// largest error divided by the largest output of the run. The worst filter
+// and frequency pair comes out around 1.3e-4.
+#define BIQUAD_RELATIVE_TOLERANCE 1.0E-3
+// Runs a decimated-rate square wave at each player frequency through a local
+// double-precision copy of the 10th-order direct-form filters and through the
+// float biquad cascades, for all 10 filters, and compares the outputs. Also
+// prints the time per output of both forms.
+bool filterTest_runBiquadAccuracyTest(bool printMessageFlag) {
+  uint32_t aCount = filter_getIirACoefficientCount();
+  uint32_t bCount = filter_getIirBCoefficientCount();
+  static double inputs[BIQUAD_TEST_OUTPUT_COUNT];
+  static double directOutputs[BIQUAD_TEST_OUTPUT_COUNT];
+  static double biquadOutputs[BIQUAD_TEST_OUTPUT_COUNT];
+  static biquad_cascade_t cascade;
+  double directSeconds = 0.0, biquadSeconds = 0.0;
+  double worstError = 0.0;
+  bool success = true;
+  intervalTimer_init(BENCHMARK_TIMER);
+  for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++) {
+    // One square-wave half period is filter_frequencyTickTable[] ADC samples.
+    for (uint32_t i = 0; i < BIQUAD_TEST_OUTPUT_COUNT; i++)
+      inputs[i] = ((i * FILTER_FIR_DECIMATION_FACTOR) /
+                   filter_frequencyTickTable[frequency]) % 2
+                      ? 1.0
+                      : -1.0;
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+         filterNumber++) {
+      const double *a = filter_getIirACoefficientArray(filterNumber);
+      const double *b = filter_getIirBCoefficientArray(filterNumber);
+      // Direct form: x[] and z[] hold the last inputs and outputs, newest at 0.
+      double x[IIR_B_COEFFICIENT_COUNT_MAX] = {0.0};
+      double z[IIR_B_COEFFICIENT_COUNT_MAX] = {0.0};
+      intervalTimer_reset(BENCHMARK_TIMER);
+      intervalTimer_start(BENCHMARK_TIMER);
+      for (uint32_t i = 0; i < BIQUAD_TEST_OUTPUT_COUNT; i++) {
+        for (uint32_t k = bCount - 1; k > 0; k--)
+          x[k] = x[k - 1];
+        x[0] = inputs[i];
+        double y = 0.0;
+        for (uint32_t k = 0; k < bCount; k++)
+          y += b[k] * x[k];
+        for (uint32_t k = 0; k < aCount; k++)
+          y -= a[k] * z[k];
+        for (uint32_t k = aCount - 1; k > 0; k--)
+          z[k] = z[k - 1];
+        z[0] = y;
+        directOutputs[i] = y;
+      }
+      intervalTimer_stop(BENCHMARK_TIMER);
+      directSeconds += intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+      biquad_init(&cascade, filter_getIirSectionArray(filterNumber),
+                  FILTER_IIR_SECTION_COUNT);
+      intervalTimer_reset(BENCHMARK_TIMER);
+      intervalTimer_start(BENCHMARK_TIMER);
+      for (uint32_t i = 0; i < BIQUAD_TEST_OUTPUT_COUNT; i++)
+        biquadOutputs[i] = biquad_filter(&cascade, (float)inputs[i]);
+      intervalTimer_stop(BENCHMARK_TIMER);
+      biquadSeconds += intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+
+      double peak = 0.0, error = 0.0;
+      for (uint32_t i = 0; i < BIQUAD_TEST_OUTPUT_COUNT; i++) {
+        peak = fmax(peak, fabs(directOutputs[i]));
+        error = fmax(error, fabs(directOutputs[i] - biquadOutputs[i]));
+      }
+      double relativeError = error / peak;
+      worstError = fmax(worstError, relativeError);
+      if (relativeError > BIQUAD_RELATIVE_TOLERANCE) {
+        printf("filterTest_runBiquadAccuracyTest: filter %d, frequency %d: "
+               "relative error %le.\n",
+               filterNumber, frequency, relativeError);
+        success = false;
+      }
+    }
+  }
+  if (printMessageFlag || !success) {
+    printf("biquad vs direct form: worst relative error %le (limit %le)\n",
+           worstError, BIQUAD_RELATIVE_TOLERANCE);
+    printf("  direct form (double): %.0f ns/output\n",
+           1.0E9 * directSeconds /
+               (BIQUAD_TEST_OUTPUT_COUNT * FILTER_FREQUENCY_COUNT *
+                FILTER_FREQUENCY_COUNT));
+    printf("  biquads (float):      %.0f ns/output\n",
+           1.0E9 * biquadSeconds /
+               (BIQUAD_TEST_OUTPUT_COUNT * FILTER_FREQUENCY_COUNT *
+                FILTER_FREQUENCY_COUNT));
+  }
+  printf("filterTest_runBiquadAccuracyTest %s.\n",
+         success ? "passed" : "failed");
+  return success;
+}
+
+#define IIR_BANK_TEST_OUTPUT_COUNT 10000 // One second of decimated outputs.
+// Steps after which the test switches to filter_iirFilter() for a while, to
+// check that the state moves correctly between the two paths.
+#define IIR_BANK_TEST_SWITCH_START 4000
+#define IIR_BANK_TEST_SWITCH_END 4100
+// The direct-form bank adds the same terms in the same order, so outputs must
+// match exactly. Float lanes on NEON flush denormals, hence a tiny margin.
+#define IIR_BANK_TEST_TOLERANCE 1.0E-30
+// Feeds the same random FIR outputs to filter_iirFilter(), called for every
+// filter number, and to filter_iirFilterAll(), and compares all outputs and
+// the final power values. Also prints the time per step of both paths.
+bool filterTest_runIirBankTest(bool printMessageFlag) {
+  static double inputs[IIR_BANK_TEST_OUTPUT_COUNT];
+  static double channelOutputs[IIR_BANK_TEST_OUTPUT_COUNT]
+                              [FILTER_FREQUENCY_COUNT];
+  double bankOutputs[FILTER_FREQUENCY_COUNT];
+  double channelPower[FILTER_FREQUENCY_COUNT];
+  for (uint32_t i = 0; i < IIR_BANK_TEST_OUTPUT_COUNT; i++)
+    inputs[i] = 2.0 * filterTest_randomValue0To1() - 1.0;
+  intervalTimer_init(BENCHMARK_TIMER);
+
+  // One filter at a time.
+  filter_init();
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < IIR_BANK_TEST_OUTPUT_COUNT; i++) {
+    filter_addFirOutput(inputs[i]);
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+         filterNumber++)
+      channelOutputs[i][filterNumber] = filter_iirFilter(filterNumber);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double channelSeconds =
+      intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+  for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+       filterNumber++)
+    channelPower[filterNumber] = filter_computePower(filterNumber, true, false);
+
+  // Whole bank per step, with a stretch of per-filter calls in the middle.
+  filter_init();
+  double worstError = 0.0;
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < IIR_BANK_TEST_OUTPUT_COUNT; i++) {
+    filter_addFirOutput(inputs[i]);
+    if (i >= IIR_BANK_TEST_SWITCH_START && i < IIR_BANK_TEST_SWITCH_END) {
+      for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+           filterNumber++)
+        bankOutputs[filterNumber] = filter_iirFilter(filterNumber);
+    } else {
+      filter_iirFilterAll(bankOutputs);
+    }
+    for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+         filterNumber++)
+      worstError = fmax(worstError, fabs(bankOutputs[filterNumber] -
+                                         channelOutputs[i][filterNumber]));
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  double bankSeconds = intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+  for (uint16_t filterNumber = 0; filterNumber < FILTER_FREQUENCY_COUNT;
+       filterNumber++)
+    worstError =
+        fmax(worstError,
+             fabs(filter_computePower(filterNumber, true, false) -
+                  channelPower[filterNumber]));
+  filter_init();
+
+  bool success = worstError <= IIR_BANK_TEST_TOLERANCE;
+  if (printMessageFlag || !success) {
+    printf("filterTest_runIirBankTest: worst difference %le.\n", worstError);
+    printf("  filter_iirFilter() x %d: %.0f ns/step\n", FILTER_FREQUENCY_COUNT,
+           1.0E9 * channelSeconds / IIR_BANK_TEST_OUTPUT_COUNT);
+    printf("  filter_iirFilterAll():   %.0f ns/step (%.1fx)\n",
+           1.0E9 * bankSeconds / IIR_BANK_TEST_OUTPUT_COUNT,
+           channelSeconds / bankSeconds);
+  }
+  printf("filterTest_runIirBankTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+#define POWER_TRACKER_TEST_WINDOW_SIZE 2000
+#define POWER_TRACKER_TEST_UPDATE_COUNT 200000
+#define POWER_TRACKER_TEST_CHECK_INTERVAL 1000 // Updates between exact sums.
+#define POWER_TRACKER_TEST_BURST_LENGTH 5000   // Loud and quiet stretches.
+#define POWER_TRACKER_TEST_LOUD_AMPLITUDE 1.0E3
+#define POWER_TRACKER_TEST_QUIET_AMPLITUDE 1.0E-3
+// Error of the resynced tracker divided by the largest exact sum of the run.
+// Between resyncs at most one window of updates can add rounding errors, each
+// around 2^-53 of the loud power.
+#define POWER_TRACKER_TEST_RELATIVE_TOLERANCE 1.0E-12
+// Runs alternating loud and quiet random bursts through two trackers, one
+// without resync and one resynced once per window, and compares both against
+// exact sums. Rounding errors from the loud bursts stay in a pure running sum
+// forever, which shows up as a large relative error in the quiet stretches.
+// Prints both errors and the work statistics.
+bool filterTest_runPowerTrackerTest(bool printMessageFlag) {
+  static double window[POWER_TRACKER_TEST_WINDOW_SIZE];
+  powerTracker_t drifting, resynced;
+  powerTracker_init(&drifting, POWER_TRACKER_TEST_WINDOW_SIZE, 0);
+  powerTracker_init(&resynced, POWER_TRACKER_TEST_WINDOW_SIZE,
+                    POWER_TRACKER_TEST_WINDOW_SIZE);
+  for (uint32_t i = 0; i < POWER_TRACKER_TEST_WINDOW_SIZE; i++)
+    window[i] = 0.0;
+  uint32_t oldestIndex = 0;
+  double worstDrifting = 0.0, worstResynced = 0.0; // Relative to exact.
+  double largestExact = 0.0, worstResyncedError = 0.0;
+  for (uint32_t n = 0; n < POWER_TRACKER_TEST_UPDATE_COUNT; n++) {
+    double amplitude = (n / POWER_TRACKER_TEST_BURST_LENGTH) % 2
+                           ? POWER_TRACKER_TEST_QUIET_AMPLITUDE
+                           : POWER_TRACKER_TEST_LOUD_AMPLITUDE;
+    double x = amplitude * (2.0 * filterTest_randomValue0To1() - 1.0);
+    double oldest = window[oldestIndex];
+    window[oldestIndex] = x;
+    oldestIndex = (oldestIndex + 1) % POWER_TRACKER_TEST_WINDOW_SIZE;
+    powerTracker_update(&drifting, oldest, x);
+    powerTracker_update(&resynced, oldest, x);
+    bool check = (n + 1) % POWER_TRACKER_TEST_CHECK_INTERVAL == 0;
+    if (!check && !powerTracker_needsResync(&resynced))
+      continue;
+    double exact = 0.0;
+    for (uint32_t i = 0; i < POWER_TRACKER_TEST_WINDOW_SIZE; i++)
+      exact += window[i] * window[i];
+    if (check) {
+      worstDrifting = fmax(worstDrifting,
+                           fabs(powerTracker_getSum(&drifting) - exact) / exact);
+      double error = fabs(powerTracker_getSum(&resynced) - exact);
+      worstResynced = fmax(worstResynced, error / exact);
+      worstResyncedError = fmax(worstResyncedError, error);
+      largestExact = fmax(largestExact, exact);
+    }
+    if (powerTracker_needsResync(&resynced))
+      powerTracker_resync(&resynced, exact);
+  }
+  bool success = worstResyncedError / largestExact <=
+                 POWER_TRACKER_TEST_RELATIVE_TOLERANCE;
+  if (printMessageFlag || !success) {
+    powerTracker_stats_t stats = powerTracker_getStats(&resynced);
+    printf("power tracker over %d updates, window %d:\n",
+           POWER_TRACKER_TEST_UPDATE_COUNT, POWER_TRACKER_TEST_WINDOW_SIZE);
+    printf("  no resync:         worst relative error %le\n", worstDrifting);
+    printf("  resync per window: worst relative error %le\n", worstResynced);
+    printf("  resync per window: worst error / largest power %le (limit %le)\n",
+           worstResyncedError / largestExact,
+           POWER_TRACKER_TEST_RELATIVE_TOLERANCE);
+    printf("  %d resyncs, max drift %le, %llu squares computed, %llu saved\n",
+           stats.resyncCount, stats.maxDrift,
+           (unsigned long long)stats.squaresComputed,
+           (unsigned long long)stats.squaresSaved);
+  }
+  printf("filterTest_runPowerTrackerTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+// Synthetic ADC trace for the power-mode comparison: shots are 200 ms square
+// waves at a player frequency, separated by 500 ms of noise only.
+#define POWER_MODE_TEST_SHOT_COUNT 4
+#define POWER_MODE_TEST_SHOT_LENGTH 20000 // ADC samples (200 ms).
+#define POWER_MODE_TEST_GAP_LENGTH 50000  // ADC samples (500 ms).
+#define POWER_MODE_TEST_SAMPLE_COUNT                                           \
+  (POWER_MODE_TEST_SHOT_COUNT *                                                \
+       (POWER_MODE_TEST_GAP_LENGTH + POWER_MODE_TEST_SHOT_LENGTH) +            \
+   POWER_MODE_TEST_GAP_LENGTH)
+#define POWER_MODE_TEST_ADC_MIDSCALE 2048
+#define POWER_MODE_TEST_NOISE_AMPLITUDE 200 // ADC counts, uniform.
+#define POWER_MODE_TEST_BLOCK_SIZE 100
+// Hit rule used for both modes: the largest power beats the median power
+// times the fudge factor, then hits are locked out for 500 ms.
+#define POWER_MODE_TEST_FUDGE_FACTOR 20.0
+#define POWER_MODE_TEST_LOCKOUT_OUTPUTS 5000
+#define POWER_MODE_TEST_SETTLE_OUTPUTS 2000
+#define POWER_MODE_TEST_MAX_HIT_COUNT 16
+static const uint16_t powerModeTestShotFrequencies[POWER_MODE_TEST_SHOT_COUNT] =
+    {0, 3, 6, 9};
+static const uint16_t powerModeTestShotAmplitudes[POWER_MODE_TEST_SHOT_COUNT] =
+    {1500, 800, 400, 200};
+
+// Returns ADC sample t of the synthetic trace. The noise comes from a hash
+// of t (the murmur3 finalizer), so both power modes see exactly the same
+// samples.
+static buffer_data_t filterTest_powerModeTraceSample(uint32_t t) {
+  uint32_t hash = t;
+  hash = (hash ^ (hash >> 16)) * 0x85ebca6bu;
+  hash = (hash ^ (hash >> 13)) * 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  int32_t value = POWER_MODE_TEST_ADC_MIDSCALE +
+                  (int32_t)(hash % (2 * POWER_MODE_TEST_NOISE_AMPLITUDE + 1)) -
+                  POWER_MODE_TEST_NOISE_AMPLITUDE;
+  uint32_t shotPeriod = POWER_MODE_TEST_GAP_LENGTH + POWER_MODE_TEST_SHOT_LENGTH;
+  uint32_t shot = t / shotPeriod;
+  uint32_t offset = t % shotPeriod;
+  if (shot < POWER_MODE_TEST_SHOT_COUNT && offset >= POWER_MODE_TEST_GAP_LENGTH) {
+    uint16_t tick = filter_frequencyTickTable[powerModeTestShotFrequencies[shot]];
+    int32_t amplitude = powerModeTestShotAmplitudes[shot];
+    value += (offset % tick) < ONE_HALF(tick) ? -amplitude : amplitude;
+  }
+  return value < 0 ? 0 : (value > 4095 ? 4095 : value);
+}
+
+// Runs the synthetic trace through the filters in the given power mode and
+// applies the hit rule after every decimated output. Records the output index
+// and frequency of each hit and returns the hit count.
+static uint32_t filterTest_runPowerModeTrace(filter_powerMode_t mode,
+                                             uint32_t hitOutputs[],
+                                             uint16_t hitFrequencies[]) {
+  buffer_data_t block[POWER_MODE_TEST_BLOCK_SIZE];
+  double firOutputs[FILTER_BLOCK_MAX_OUTPUT_COUNT(POWER_MODE_TEST_BLOCK_SIZE)];
+  double iirOutputs[FILTER_FREQUENCY_COUNT];
+  double sorted[FILTER_FREQUENCY_COUNT];
+  // Start locked out until the power windows have filled once.
+  uint32_t hitCount = 0, outputIndex = 0;
+  uint32_t lockout = POWER_MODE_TEST_SETTLE_OUTPUTS;
+  filter_initWithPowerMode(mode);
+  for (uint32_t t = 0; t < POWER_MODE_TEST_SAMPLE_COUNT;
+       t += POWER_MODE_TEST_BLOCK_SIZE) {
+    for (uint32_t i = 0; i < POWER_MODE_TEST_BLOCK_SIZE; i++)
+      block[i] = filterTest_powerModeTraceSample(t + i);
+    uint32_t outputCount =
+        filter_processBlock(block, POWER_MODE_TEST_BLOCK_SIZE, firOutputs);
+    for (uint32_t j = 0; j < outputCount; j++, outputIndex++) {
+      filter_addFirOutput(firOutputs[j]);
+      filter_iirFilterAll(iirOutputs);
+      uint16_t maxIndex = 0;
+      for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+        sorted[i] = filter_computePower(i, false, false);
+        if (sorted[i] > sorted[maxIndex])
+          maxIndex = i;
+      }
+      if (lockout > 0) {
+        lockout--;
+        continue;
+      }
+      // Insertion sort to find the median.
+      for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++)
+        for (uint16_t k = i; k > 0 && sorted[k - 1] > sorted[k]; k--) {
+          double swap = sorted[k];
+          sorted[k] = sorted[k - 1];
+          sorted[k - 1] = swap;
+        }
+      double median = (sorted[FILTER_FREQUENCY_COUNT / 2 - 1] +
+                       sorted[FILTER_FREQUENCY_COUNT / 2]) /
+                      2.0;
+      if (sorted[FILTER_FREQUENCY_COUNT - 1] >
+              POWER_MODE_TEST_FUDGE_FACTOR * median &&
+          hitCount < POWER_MODE_TEST_MAX_HIT_COUNT) {
+        hitOutputs[hitCount] = outputIndex;
+        hitFrequencies[hitCount] = maxIndex;
+        hitCount++;
+        lockout = POWER_MODE_TEST_LOCKOUT_OUTPUTS;
+      }
+    }
+  }
+  return hitCount;
+}
+
+// Compares hit detection with the sliding-window power and with the leaky
+// integrator (FILTER_POWER_EMA) on the same synthetic shot trace. Shots get
+// weaker one after another. Each hit is classified as a detection (inside a
+// shot, at its frequency, first hit for that shot), a tail (at the frequency
+// of the shot before it, after that shot's detection) or false. The EMA power
+// decays exponentially after a shot ends instead of dropping to zero once the
+// shot leaves the window, so it can re-trigger after the lockout: those tails
+// are reported, not failed. Passes if both modes detect every shot, the window
+// mode has no tails, and neither mode has false hits.
+bool filterTest_runPowerModeComparisonTest(bool printMessageFlag) {
+#ifdef FILTER_FIXED_POINT
+  printf("filterTest_runPowerModeComparisonTest skipped: filter.c is built "
+         "with FILTER_FIXED_POINT.\n");
+  return true;
+#endif
+  static const filter_powerMode_t modes[] = {FILTER_POWER_SLIDING_WINDOW,
+                                             FILTER_POWER_EMA};
+  static const char *modeNames[] = {"sliding window", "EMA"};
+  uint32_t shotPeriod =
+      (POWER_MODE_TEST_GAP_LENGTH + POWER_MODE_TEST_SHOT_LENGTH) /
+      FILTER_FIR_DECIMATION_FACTOR;
+  uint32_t gapOutputs = POWER_MODE_TEST_GAP_LENGTH / FILTER_FIR_DECIMATION_FACTOR;
+  uint32_t hitOutputs[POWER_MODE_TEST_MAX_HIT_COUNT];
+  uint16_t hitFrequencies[POWER_MODE_TEST_MAX_HIT_COUNT];
+  bool success = true;
+  for (uint32_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    uint32_t hitCount =
+        filterTest_runPowerModeTrace(modes[m], hitOutputs, hitFrequencies);
+    bool detected[POWER_MODE_TEST_SHOT_COUNT] = {false};
+    uint32_t detectionCount = 0, tailCount = 0, falseCount = 0;
+    for (uint32_t h = 0; h < hitCount; h++) {
+      uint32_t shot = hitOutputs[h] / shotPeriod;
+      int32_t offset = (int32_t)(hitOutputs[h] % shotPeriod) - gapOutputs;
+      const char *kind;
+      if (offset >= 0 && shot < POWER_MODE_TEST_SHOT_COUNT && !detected[shot] &&
+          hitFrequencies[h] == powerModeTestShotFrequencies[shot]) {
+        detected[shot] = true;
+        detectionCount++;
+        kind = "detection";
+      } else if (offset < 0 && shot > 0 && detected[shot - 1] &&
+                 hitFrequencies[h] == powerModeTestShotFrequencies[shot - 1]) {
+        tailCount++;
+        kind = "tail of the previous shot";
+      } else {
+        falseCount++;
+        kind = "false";
+      }
+      if (printMessageFlag)
+        printf("  %s: frequency %d, %.1f ms from the start of shot %d (%s)\n",
+               modeNames[m], hitFrequencies[h], offset / 10.0, shot, kind);
+    }
+    bool modeSuccess = detectionCount == POWER_MODE_TEST_SHOT_COUNT &&
+                       falseCount == 0 &&
+                       (modes[m] == FILTER_POWER_EMA || tailCount == 0);
+    if (printMessageFlag || !modeSuccess)
+      printf("%s power: %d of %d shots detected, %d tails, %d false hits\n",
+             modeNames[m], detectionCount, POWER_MODE_TEST_SHOT_COUNT,
+             tailCount, falseCount);
+    success &= modeSuccess;
+  }
+  filter_init();
+  if (printMessageFlag)
+    printf("EMA power leaves the output queues untouched: %d bytes kept out "
+           "of the cache\n",
+           (int)(FILTER_FREQUENCY_COUNT *
+                 queue_storageLength(queue_size(filter_getIirOutputQueue(0)),
+                                     QUEUE_LAYOUT_POWER_OF_TWO) *
+                 sizeof(queue_data_t)));
+  printf("filterTest_runPowerModeComparisonTest %s.\n",
+         success ? "passed" : "failed");
+  return success;
+}
+
+// Square wave at each player frequency, long enough to fill the power window
+// twice. The first window is ignored when comparing the final decisions.
+#define GOERTZEL_TEST_BLOCK_SIZE 100
+#define GOERTZEL_TEST_OUTPUT_COUNT 4000 // Decimated outputs (400 ms).
+#define GOERTZEL_TEST_FUDGE_FACTOR 20.0
+#define GOERTZEL_TEST_RESYNC_INTERVAL 1500 // Several resyncs in the run.
+#define GOERTZEL_TEST_POWER_TOLERANCE 1e-12 // Relative to the largest bin.
+// Multiplies per decimated output: a 10th-order IIR filter (11 + 10) plus
+// the incremental power (2) for each frequency, versus one multiply to
+// advance and three to read out each Goertzel bin.
+#define GOERTZEL_TEST_IIR_MULTIPLIES (FILTER_FREQUENCY_COUNT * (11 + 10 + 2))
+#define GOERTZEL_TEST_GOERTZEL_MULTIPLIES (FILTER_FREQUENCY_COUNT * (1 + 3))
+
+// Returns the frequency number with the largest power and sets *hit if it
+// beats the median power times GOERTZEL_TEST_FUDGE_FACTOR.
+static uint16_t filterTest_goertzelTestDecision(const double powerValues[],
+                                                bool *hit) {
+  double sorted[FILTER_FREQUENCY_COUNT];
+  uint16_t maxIndex = 0;
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    sorted[i] = powerValues[i];
+    if (powerValues[i] > powerValues[maxIndex])
+      maxIndex = i;
+  }
+  for (uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++)
+    for (uint16_t k = i; k > 0 && sorted[k - 1] > sorted[k]; k--) {
+      double swap = sorted[k];
+      sorted[k] = sorted[k - 1];
+      sorted[k - 1] = swap;
+    }
+  double median =
+      (sorted[FILTER_FREQUENCY_COUNT / 2 - 1] + sorted[FILTER_FREQUENCY_COUNT / 2]) /
+      2.0;
+  *hit = powerValues[maxIndex] > GOERTZEL_TEST_FUDGE_FACTOR * median;
+  return maxIndex;
+}
+
+// Runs square waves at every player frequency, generated with
+// computeAdcBufferInput(), through the IIR bank (FILTER_POWER_SLIDING_WINDOW)
+// and through the Goertzel bins (FILTER_POWER_GOERTZEL). Both backends see the
+// same FIR outputs. Passes if both detect the right frequency once the power
+// window has filled and keep detecting it to the end, and if resynced sliding
+// bins still match a DFT over their windows. Prints the first output
+// at which each backend detects the tone and the time per
+// filter_computeAllPowers() call.
+bool filterTest_runGoertzelTest(bool printMessageFlag) {
+#ifdef FILTER_FIXED_POINT
+  printf("filterTest_runGoertzelTest skipped: filter.c is built with "
+         "FILTER_FIXED_POINT.\n");
+  return true;
+#endif
+  static const filter_powerMode_t modes[] = {FILTER_POWER_SLIDING_WINDOW,
+                                             FILTER_POWER_GOERTZEL};
+  static const char *modeNames[] = {"IIR bank", "Goertzel"};
+  static double firOutputs[GOERTZEL_TEST_OUTPUT_COUNT +
+                           FILTER_BLOCK_MAX_OUTPUT_COUNT(GOERTZEL_TEST_BLOCK_SIZE)];
+  uint32_t settleOutputs = queue_size(filter_getIirOutputQueue(0));
+  double seconds[2] = {0.0, 0.0};
+  bool success = true;
+  intervalTimer_init(BENCHMARK_TIMER);
+  for (uint16_t frequency = 0; frequency < FILTER_FREQUENCY_COUNT; frequency++) {
+    // FIR outputs of the square wave, shared by both backends.
+    uint16_t period = filter_frequencyTickTable[frequency];
+    buffer_data_t block[GOERTZEL_TEST_BLOCK_SIZE];
+    uint32_t firOutputCount = 0;
+    filter_init();
+    for (uint32_t t = 0; firOutputCount < GOERTZEL_TEST_OUTPUT_COUNT;
+         t += GOERTZEL_TEST_BLOCK_SIZE) {
+      for (uint32_t i = 0; i < GOERTZEL_TEST_BLOCK_SIZE; i++)
+        block[i] = computeAdcBufferInput((t + i) % period, period);
+      firOutputCount += filter_processBlock(block, GOERTZEL_TEST_BLOCK_SIZE,
+                                            &firOutputs[firOutputCount]);
+    }
+    for (uint32_t m = 0; m < 2; m++) {
+      double powerValues[FILTER_FREQUENCY_COUNT];
+      // Timed pass.
+      filter_initWithPowerMode(modes[m]);
+      intervalTimer_reset(BENCHMARK_TIMER);
+      intervalTimer_start(BENCHMARK_TIMER);
+      for (uint32_t j = 0; j < GOERTZEL_TEST_OUTPUT_COUNT; j++) {
+        filter_addFirOutput(firOutputs[j]);
+        filter_computeAllPowers(powerValues);
+      }
+      intervalTimer_stop(BENCHMARK_TIMER);
+      seconds[m] += intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+      // Checked pass.
+      filter_initWithPowerMode(modes[m]);
+      int32_t firstDetection = -1;
+      bool modeSuccess = true;
+      for (uint32_t j = 0; j < GOERTZEL_TEST_OUTPUT_COUNT; j++) {
+        bool hit;
+        filter_addFirOutput(firOutputs[j]);
+        filter_computeAllPowers(powerValues);
+        uint16_t decision = filterTest_goertzelTestDecision(powerValues, &hit);
+        bool detected = hit && decision == frequency;
+        if (detected && firstDetection < 0)
+          firstDetection = j;
+        if (j >= settleOutputs && !detected) {
+          if (modeSuccess)
+            printf("%s: frequency %d not detected at output %d (max at %d, "
+                   "hit %d)\n",
+                   modeNames[m], frequency, j, decision, hit);
+          modeSuccess = false;
+        }
+      }
+      if (printMessageFlag)
+        printf("  frequency %d, %-8s: first detected after %.1f ms\n",
+               frequency, modeNames[m],
+               firstDetection / (double)(FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000 /
+                                          FILTER_FIR_DECIMATION_FACTOR) *
+                   1000.0);
+      success &= modeSuccess;
+    }
+    // The sliding bins, resynced or not, must match a DFT over each window.
+    static goertzel_bank_t bank;
+    goertzel_init(&bank, filter_frequencyTickTable, FILTER_FREQUENCY_COUNT,
+                  FILTER_FIR_DECIMATION_FACTOR, GOERTZEL_MAX_WINDOW_SIZE,
+                  GOERTZEL_TEST_RESYNC_INTERVAL);
+    for (uint32_t j = 0; j < GOERTZEL_TEST_OUTPUT_COUNT; j++)
+      goertzel_addInput(&bank, firOutputs[j]);
+    double largestPower = 0.0, worstError = 0.0;
+    for (uint16_t bin = 0; bin < FILTER_FREQUENCY_COUNT; bin++) {
+      uint32_t windowSize = goertzel_getWindowSize(&bank, bin);
+      double omega = 2.0 * M_PI * FILTER_FIR_DECIMATION_FACTOR /
+                     filter_frequencyTickTable[bin];
+      double real = 0.0, imaginary = 0.0;
+      for (uint32_t m = 0; m < windowSize; m++) {
+        double x = firOutputs[GOERTZEL_TEST_OUTPUT_COUNT - 1 - m];
+        real += x * cos(omega * m);
+        imaginary += x * sin(omega * m);
+      }
+      double dftPower = 2.0 * (real * real + imaginary * imaginary) /
+                        ((double)windowSize * windowSize);
+      double error = fabs(goertzel_getPower(&bank, bin) - dftPower);
+      largestPower = fmax(largestPower, dftPower);
+      worstError = fmax(worstError, error);
+    }
+    if (worstError > GOERTZEL_TEST_POWER_TOLERANCE * largestPower) {
+      printf("Goertzel: frequency %d, bins differ from the DFT by %le (largest "
+             "power %le)\n",
+             frequency, worstError, largestPower);
+      success = false;
+    }
+  }
+  filter_init();
+  if (printMessageFlag) {
+    double calls = (double)FILTER_FREQUENCY_COUNT * GOERTZEL_TEST_OUTPUT_COUNT;
+    printf("filter_computeAllPowers(), %d multiplies per output:\n",
+           GOERTZEL_TEST_IIR_MULTIPLIES);
+    printf("  IIR bank: %.0f ns/output\n", seconds[0] / calls * 1e9);
+    printf("  Goertzel: %.0f ns/output (%.1fx), %d multiplies per output\n",
+           seconds[1] / calls * 1e9, seconds[0] / seconds[1],
+           GOERTZEL_TEST_GOERTZEL_MULTIPLIES);
+  }
+  printf("filterTest_runGoertzelTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
+// Calls filter_initWithPowerMode() repeatedly, in every power mode, and checks
+// that the filter queues keep the same static storage (no heap allocation, so
+// no leak from repeated initialization) and that the sliding-window queues
+// come back full of zeros. Prints the RAM budget of the filter state.
+bool filterTest_runStaticStateTest(bool printMessageFlag) {
+  bool success = true;
+  filter_init();
+  const queue_data_t *yData = filter_getYQueue()->data;
+  const queue_data_t *zData[FILTER_FREQUENCY_COUNT];
+  const queue_data_t *outputData[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    zData[i] = filter_getZQueue(i)->data;
+    outputData[i] = filter_getIirOutputQueue(i)->data;
+  }
+  const filter_powerMode_t modes[] = {FILTER_POWER_EMA, FILTER_POWER_GOERTZEL,
+                                      FILTER_POWER_SLIDING_WINDOW};
+  for (uint32_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+    filter_initWithPowerMode(modes[m]);
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (filter_getYQueue()->data != yData ||
+          filter_getZQueue(i)->data != zData[i] ||
+          filter_getIirOutputQueue(i)->data != outputData[i] ||
+          filter_getYQueue()->ownsData || filter_getZQueue(i)->ownsData ||
+          filter_getIirOutputQueue(i)->ownsData) {
+        printf("filterTest_runStaticStateTest: the queues of filter %d moved "
+               "or were allocated on the heap\n", i);
+        success = false;
+        break;
+      }
+    }
+  }
+  // The last init was FILTER_POWER_SLIDING_WINDOW: full windows of zeros.
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    queue_t *q = filter_getIirOutputQueue(i);
+    if (!queue_full(q) || queue_readElementAt(q, 0) != 0.0 ||
+        queue_readElementAt(q, queue_size(q) - 1) != 0.0) {
+      printf("filterTest_runStaticStateTest: outputQueue %d is not a full "
+             "window of zeros\n", i);
+      success = false;
+    }
+  }
+  if (printMessageFlag)
+    filter_printRamBudget();
+  printf("filterTest_runStaticStateTest %s.\n", success ? "passed" : "failed");
+  return success;
+}
+
 // Copies powerValues to currentPowerValues, the same array
 // that is used to hold the values after power has been computed
 // by filter_computePower().
@@ -994,6 +1992,27 @@ bool filter_runTest(void) {
                                              PRINT_INFO_MESSAGES);
   // Verifies correct functionality of the power computation.
   success &= filterTest_runPowerTest();
+  // Compares the fixed-point pipeline against the double-precision filters.
+  success &= filterTest_runFixedPointAccuracyTest(PRINT_INFO_MESSAGES);
+  filterTest_runFixedPointBenchmark();
+  // Compares the SIMD FIR kernel against the queue-based FIR.
+  success &= filterTest_runFirKernelBenchmark();
+  // Confirms the symmetric lowpass runs folded and still matches.
+  success &= filterTest_runFoldedFirTest(PRINT_INFO_MESSAGES);
+  // Confirms filter_processBlock() matches the per-sample FIR path.
+  success &= filterTest_runProcessBlockTest(PRINT_INFO_MESSAGES);
+  // Compares the float biquad cascades against the direct-form IIR filters.
+  success &= filterTest_runBiquadAccuracyTest(PRINT_INFO_MESSAGES);
+  // Confirms filter_iirFilterAll() matches filter_iirFilter().
+  success &= filterTest_runIirBankTest(PRINT_INFO_MESSAGES);
+  // Shows the drift of the running power sums with and without resync.
+  success &= filterTest_runPowerTrackerTest(PRINT_INFO_MESSAGES);
+  // Compares hit detection with window and EMA power on a shot trace.
+  success &= filterTest_runPowerModeComparisonTest(PRINT_INFO_MESSAGES);
+  // Compares the Goertzel bins with the IIR bank on square waves.
+  success &= filterTest_runGoertzelTest(PRINT_INFO_MESSAGES);
+  // Confirms repeated filter_init() calls reuse the static filter state.
+  success &= filterTest_runStaticStateTest(PRINT_INFO_MESSAGES);
   // Plots the frequency response of the FIR filter against all user and other
   // test frequencies. All frequencies are expressed as a square wave.
   filterTest_runSquareWaveFirPowerTest(PRINT_INFO_MESSAGES, PLOT_INPUT);
@@ -0,0 +1,194 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "intervalTimer.h"
+#include "powerRank.h"
+#include "powerRankTest.h"
+
+#define RANK_COUNT FILTER_FREQUENCY_COUNT
+#define RANDOM_TEST_COUNT 10000
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_1
+#define BENCHMARK_OUTPUT_COUNT 2000 // Decimated outputs of drifting powers.
+#define BENCHMARK_PASS_COUNT 10     // Times each ranking runs over them.
+#define BENCHMARK_HIT_INTERVAL 500  // Outputs between simulated hits.
+#define BENCHMARK_HIT_GAIN 1000.0   // Power of a hit over the floor.
+
+// A power and its frequency number, for qsort() and the insertion sort.
+typedef struct {
+  double power;
+  uint16_t frequency;
+} rankedPower_t;
+
+// Drifting powers for the benchmark, one set per decimated output.
+static double benchmarkPowers[BENCHMARK_OUTPUT_COUNT][RANK_COUNT];
+
+// Orders rankedPower_t by power for qsort().
+static int comparePowers(const void *a, const void *b) {
+  double powerA = ((const rankedPower_t *)a)->power;
+  double powerB = ((const rankedPower_t *)b)->power;
+  return (powerA > powerB) - (powerA < powerB);
+}
+
+// Ranks powers[] with qsort().
+static void rankWithQsort(const double powers[], powerRank_t *rank) {
+  rankedPower_t pairs[RANK_COUNT];
+  for (uint16_t i = 0; i < RANK_COUNT; i++)
+    pairs[i] = (rankedPower_t){powers[i], i};
+  qsort(pairs, RANK_COUNT, sizeof(pairs[0]), comparePowers);
+  for (uint16_t i = 0; i < RANK_COUNT; i++) {
+    rank->power[i] = pairs[i].power;
+    rank->frequency[i] = pairs[i].frequency;
+  }
+}
+
+// Ranks powers[] with an insertion sort that starts from frequency order
+// every time.
+static void rankWithInsertionSort(const double powers[], powerRank_t *rank) {
+  for (uint16_t i = 0; i < RANK_COUNT; i++) {
+    double power = powers[i];
+    uint16_t j = i;
+    for (; j > 0 && rank->power[j - 1] > power; j--) {
+      rank->power[j] = rank->power[j - 1];
+      rank->frequency[j] = rank->frequency[j - 1];
+    }
+    rank->power[j] = power;
+    rank->frequency[j] = i;
+  }
+}
+
+// Returns true if rank holds powers[] in ascending order, each frequency
+// number exactly once and next to its own power.
+static bool isRankOf(const powerRank_t *rank, const double powers[]) {
+  bool seen[RANK_COUNT] = {false};
+  for (uint16_t i = 0; i < RANK_COUNT; i++) {
+    uint16_t frequency = rank->frequency[i];
+    if (frequency >= RANK_COUNT || seen[frequency] ||
+        rank->power[i] != powers[frequency] ||
+        (i > 0 && rank->power[i - 1] > rank->power[i]))
+      return false;
+    seen[frequency] = true;
+  }
+  return true;
+}
+
+// Checks powerRank_sort() on every input of zeros and ones, which by the 0-1
+// principle covers every input, and powerRank_sort() and powerRank_update()
+// on random powers against qsort().
+static bool powerRank_sortTest(void) {
+  bool testResult = true;
+  double powers[RANK_COUNT];
+  powerRank_t rank, updatedRank, qsortRank;
+  for (uint32_t bits = 0; bits < (1u << RANK_COUNT) && testResult; bits++) {
+    for (uint16_t i = 0; i < RANK_COUNT; i++)
+      powers[i] = (bits >> i) & 1;
+    powerRank_sort(powers, &rank);
+    if (!isRankOf(&rank, powers)) {
+      printf("* Error: powerRank_sort() failed on the 0-1 input %03x.\n",
+             bits);
+      testResult = false;
+    }
+  }
+  powerRank_init(&updatedRank);
+  for (uint32_t test = 0; test < RANDOM_TEST_COUNT && testResult; test++) {
+    for (uint16_t i = 0; i < RANK_COUNT; i++)
+      powers[i] = (double)rand() / RAND_MAX;
+    powerRank_sort(powers, &rank);
+    powerRank_update(powers, &updatedRank);
+    rankWithQsort(powers, &qsortRank);
+    if (!isRankOf(&rank, powers) || !isRankOf(&updatedRank, powers) ||
+        powerRank_medianPower(&rank) != powerRank_medianPower(&qsortRank) ||
+        powerRank_strongest(&rank) != powerRank_strongest(&qsortRank) ||
+        powerRank_secondStrongest(&rank) !=
+            powerRank_secondStrongest(&qsortRank)) {
+      printf("* Error: ranking random powers %u disagrees with qsort().\n",
+             test);
+      testResult = false;
+    }
+  }
+  return testResult;
+}
+
+// Fills benchmarkPowers with a noise floor that drifts a little from output
+// to output, plus a strong tone on one frequency at every hit interval.
+static void makeBenchmarkPowers(void) {
+  double noiseFloor[RANK_COUNT];
+  for (uint16_t i = 0; i < RANK_COUNT; i++)
+    noiseFloor[i] = 1.0 + (double)rand() / RAND_MAX;
+  for (uint32_t output = 0; output < BENCHMARK_OUTPUT_COUNT; output++) {
+    for (uint16_t i = 0; i < RANK_COUNT; i++) {
+      noiseFloor[i] *= 1.0 + ((rand() % 201) - 100) * 1e-3;
+      benchmarkPowers[output][i] = noiseFloor[i];
+    }
+    if ((output / BENCHMARK_HIT_INTERVAL) % 2)
+      benchmarkPowers[output][(output / BENCHMARK_HIT_INTERVAL) % RANK_COUNT] *=
+          BENCHMARK_HIT_GAIN;
+  }
+}
+
+// Returns the seconds rank() takes over all the benchmark outputs, and adds
+// the median and the largest power of each ranking to *checksum.
+static double benchmarkRanking(void (*rank)(const double[], powerRank_t *),
+                               double *checksum) {
+  powerRank_t ranking;
+  powerRank_init(&ranking);
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint16_t pass = 0; pass < BENCHMARK_PASS_COUNT; pass++) {
+    for (uint32_t output = 0; output < BENCHMARK_OUTPUT_COUNT; output++) {
+      rank(benchmarkPowers[output], &ranking);
+      *checksum += powerRank_medianPower(&ranking) +
+                   ranking.power[RANK_COUNT - 1];
+    }
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Prints the time per ranking of the sorting network, the plain and the
+// incremental insertion sort and qsort(). Returns false if they disagree.
+static bool powerRank_runBenchmark(void) {
+  makeBenchmarkPowers();
+  intervalTimer_init(BENCHMARK_TIMER);
+  double networkSum = 0.0, insertionSum = 0.0, updateSum = 0.0, qsortSum = 0.0;
+  double networkSeconds = benchmarkRanking(powerRank_sort, &networkSum);
+  double insertionSeconds =
+      benchmarkRanking(rankWithInsertionSort, &insertionSum);
+  double updateSeconds = benchmarkRanking(powerRank_update, &updateSum);
+  double qsortSeconds = benchmarkRanking(rankWithQsort, &qsortSum);
+  double rankingCount = (double)BENCHMARK_OUTPUT_COUNT * BENCHMARK_PASS_COUNT;
+  printf("power ranking benchmark, %u rankings of %d drifting powers:\n",
+         BENCHMARK_OUTPUT_COUNT * BENCHMARK_PASS_COUNT, RANK_COUNT);
+  printf("  sorting network:       %.2f ns per ranking (%.1fx qsort)\n",
+         networkSeconds / rankingCount * 1e9, qsortSeconds / networkSeconds);
+  printf("  insertion sort:        %.2f ns per ranking (%.1fx qsort)\n",
+         insertionSeconds / rankingCount * 1e9,
+         qsortSeconds / insertionSeconds);
+  printf("  incremental insertion: %.2f ns per ranking (%.1fx qsort)\n",
+         updateSeconds / rankingCount * 1e9, qsortSeconds / updateSeconds);
+  printf("  qsort:                 %.2f ns per ranking\n",
+         qsortSeconds / rankingCount * 1e9);
+  bool testResult = networkSum == qsortSum && insertionSum == qsortSum &&
+                    updateSum == qsortSum;
+  if (!testResult)
+    printf("* Error: the benchmark rankings disagree.\n");
+  return testResult;
+}
+
+// Checks powerRank_sort() and powerRank_update() against qsort() and prints a
+// benchmark of the sorting network, a plain insertion sort, the incremental
+// insertion sort and qsort(). Returns false if the test fails, true otherwise.
+bool powerRank_runTest(void) {
+  bool testResult = powerRank_sortTest();
+  printf("=== powerRank sort test %s.\n", testResult ? "passed" : "failed");
+  testResult = powerRank_runBenchmark() ? testResult : false;
+  return testResult;
+}
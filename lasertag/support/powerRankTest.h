@@ -0,0 +1,20 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef POWERRANKTEST_H_
+#define POWERRANKTEST_H_
+
+#include <stdbool.h>
+
+// Checks powerRank_sort() and powerRank_update() against qsort() and prints a
+// benchmark of the sorting network, a plain insertion sort, the incremental
+// insertion sort and qsort(). Returns false if the test fails, true otherwise.
+bool powerRank_runTest(void);
+
+#endif /* POWERRANKTEST_H_ */
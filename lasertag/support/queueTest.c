@@ -9,7 +9,9 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include "intervalTimer.h"
 #include "queue.h"
 
 #define SMALL_QUEUE_SIZE 1000
@@ -17,7 +19,23 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 static queue_t smallQueue[SMALL_QUEUE_COUNT];
 static queue_t largeQueue;
+// The kind of queue that queue_runTest() is testing.
+typedef enum {
+  QUEUE_TEST_MODULO,       // queue_init().
+  QUEUE_TEST_POWER_OF_TWO, // queue_initPowerOfTwo().
+  QUEUE_TEST_MIRRORED      // queue_initMirrored().
+} queueTestKind_t;
+static queueTestKind_t testQueueKind;
 
+// Initializes a queue of the kind under test.
+static void initTestQueue(queue_t *q, queue_size_t size, const char *name) {
+  if (testQueueKind == QUEUE_TEST_MIRRORED)
+    queue_initMirrored(q, size, name);
+  else if (testQueueKind == QUEUE_TEST_POWER_OF_TWO)
+    queue_initPowerOfTwo(q, size, name);
+  else
+    queue_init(q, size, name);
+}
 
 // Prints the current contents of the queue. Handy for debugging.
 // Prints out the contents of the queue in the order of oldest element
@@ -27,7 +45,7 @@ void queue_print(queue_t *q)
 	queue_index_t index = 0;
 	queue_size_t count = queue_elementCount(q);
 
-	printf("queue name: %s\n", q->name);
+	printf("queue name: %s\n", queue_name(q));
 	while (count--) {
 		printf("%lf\n", queue_readElementAt(q, index++));
 	}
@@ -109,6 +127,7 @@ int16_t queue_runTest2(void) {
   } else {
     printf("Test 1 passed. Array contents match queue contents.\n");
   }
+  queue_garbageCollect(&q);
   success = true; // Remain optimistic.
   // Test 2: test a chain of 5 queues against a single large queue that is the
   // same size as the cumulative 5 queues.
@@ -117,14 +136,11 @@ int16_t queue_runTest2(void) {
     sprintf(nameBuffer, "test_small_queue[%d]", i);
     queue_init(&(smallQueue[i]), SMALL_QUEUE_SIZE, nameBuffer);
   }
-  for (int i = 0; i < SMALL_QUEUE_COUNT; i++) {
-    for (int j = 0; j < SMALL_QUEUE_SIZE; j++)
-      queue_overwritePush(&(smallQueue[i]), 0.0);
-  }
+  for (int i = 0; i < SMALL_QUEUE_COUNT; i++)
+    queue_fill(&(smallQueue[i]), 0.0);
   queue_init(&largeQueue, SMALL_QUEUE_SIZE * SMALL_QUEUE_COUNT,
              TEST_LARGE_QUEUE_NAME);
-  for (int i = 0; i < SMALL_QUEUE_SIZE * SMALL_QUEUE_COUNT; i++)
-    queue_overwritePush(&largeQueue, 0.0);
+  queue_fill(&largeQueue, 0.0);
   for (int i = 0; i < TEST_ITERATION_COUNT; i++) {
     double newInput = (double)rand() / (double)RAND_MAX;
     popAndPushFromChainOfSmallQueues(newInput);
@@ -159,11 +175,11 @@ static bool queue_printQueueStatus(queue_t *q, bool overflowArg,
     if (flag)                       // Print helpful informational messages.
       printf(
           "* queue_overFlow(%s) returned true. Should have returned false.\n",
-          q->name);
+          queue_name(q));
     else
       printf(
           "* queue_overFlow(%s) returned false. Should have returned true.\n",
-          q->name);
+          queue_name(q));
   }
   if ((flag = queue_underflow(q)) !=
       underflowArg) {               // Check the queue status against the flag.
@@ -171,23 +187,23 @@ static bool queue_printQueueStatus(queue_t *q, bool overflowArg,
     if (flag)                       // Print helpful informational messages.
       printf("* queue_underFlow(%s) returned true. Should have returned "
              "false.\n",
-             q->name);
+             queue_name(q));
     else
       printf("* queue_underFlow(%s) returned false. Should have returned "
              "true.\n",
-             q->name);
+             queue_name(q));
   }
   if ((flag = queue_full(q)) !=
       fullArg) {                    // Check the queue status against the flag.
     result = flag ? result : false; // Note failure.
     if (flag) {                     // Print helpful informational messages.
       printf("* queue_full(%s) returned true. Should have returned false.\n",
-             q->name);
+             queue_name(q));
       printf("* queue: %s contains %u elements.\n", queue_name(q),
              queue_elementCount(q));
     } else {
       printf("* queue_full(%s) returned false. Should have returned true.\n",
-             q->name);
+             queue_name(q));
       printf("* queue: %s contains %u elements.\n", queue_name(q),
              queue_elementCount(q));
     }
@@ -197,10 +213,10 @@ static bool queue_printQueueStatus(queue_t *q, bool overflowArg,
     result = flag ? result : false; // Note failure.
     if (flag) {                     // Print helpful informational messages.
       printf("* queue_empty(%s) returned true. Should have returned false.\n",
-             q->name);
+             queue_name(q));
     } else {
       printf("* queue_empty(%s) returned false. Should have returned true.\n",
-             q->name);
+             queue_name(q));
       printf("* queue: %s contains %u elements.\n", queue_name(q),
              queue_elementCount(q));
     }
@@ -333,7 +349,7 @@ static bool queue_pushPopTest(void) {
   uint16_t ncqPopIndexPtr = 0;  // The pop-pointer for the non-circular queue.
   uint16_t ncqPushIndexPtr = 0; // The push-pointer for the non-circular queue.
   queue_t testQ;                // This is the test Q.
-  queue_init(&testQ, PUSH_POP_Q_SIZE, PUSH_POP_Q_NAME); // Init the test Q.
+  initTestQueue(&testQ, PUSH_POP_Q_SIZE, PUSH_POP_Q_NAME); // Init the test Q.
   // Test queue_empty().
   tempResult = queue_empty(&testQ);
   if (!tempResult) {
@@ -398,6 +414,7 @@ static bool queue_pushPopTest(void) {
   } while ((ncqPushIndexPtr != ncqPopIndexPtr) ||
            (ncqPushIndexPtr != NON_CIRC_Q_SIZE - 1));
   testResult = tempResult ? testResult : false;
+  queue_garbageCollect(&testQ);
   return testResult;
 }
 
@@ -410,7 +427,7 @@ bool queue_testErrorConditions(void) {
   bool testResult = true; // Overall test results.
   // A queue for testing.
   queue_t testQ;
-  queue_init(&testQ, ERROR_CONDITION_Q_SIZE, ERROR_CONDITION_Q_NAME);
+  initTestQueue(&testQ, ERROR_CONDITION_Q_SIZE, ERROR_CONDITION_Q_NAME);
   // See that the empty function works correctly.
   tempResult = queue_empty(&testQ);
   if (!tempResult) {
@@ -491,7 +508,7 @@ bool queue_overwritePushTest(void) {
   bool testResult = true; // Keep track of overall test results.
   // Build a queue for testing.
   queue_t testQ;
-  queue_init(&testQ, OVERWRITE_PUSH_TEST_QUEUE_SIZE,
+  initTestQueue(&testQ, OVERWRITE_PUSH_TEST_QUEUE_SIZE,
              OVERWRITE_PUSH_TEST_QUEUE_NAME);
   // Allocate two arrays of test data.
   double *dataArray1 =
@@ -527,6 +544,117 @@ bool queue_overwritePushTest(void) {
   return testResult;
 }
 
+#define BULK_TEST_QUEUE_SIZE 100
+#define BULK_TEST_ITERATION_COUNT 500
+#define BULK_TEST_MAX_COUNT (2 * BULK_TEST_QUEUE_SIZE) // Per bulk call.
+#define BULK_TEST_QUEUE_NAME "bulkQ"
+// Returns true if the contents of testQ match expected[0..count - 1], oldest
+// first. Prints an error message naming operation otherwise.
+static bool queue_matchesArray(queue_t *testQ, const double expected[],
+                               queue_size_t count, const char *operation) {
+  if (queue_elementCount(testQ) != count) {
+    printf("* Error: %s holds %u elements after %s, should hold %u.\n",
+           queue_name(testQ), queue_elementCount(testQ), operation, count);
+    return false;
+  }
+  for (queue_index_t i = 0; i < count; i++) {
+    if (queue_readElementAt(testQ, i) != expected[i]) {
+      printf("* Error: %s[%u] is incorrect after %s.\n", queue_name(testQ), i,
+             operation);
+      return false;
+    }
+  }
+  // The bulk copies must keep the mirror copy up to date as well.
+  const queue_data_t *span;
+  if (testQueueKind == QUEUE_TEST_MIRRORED && count > 0 &&
+      queue_window(testQ, count, &span)) {
+    for (queue_index_t i = 0; i < count; i++) {
+      if (span[i] != expected[i]) {
+        printf("* Error: queue_window(%s)[%u] is incorrect after %s.\n",
+               queue_name(testQ), i, operation);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Applies random queue_pushMany(), queue_popMany() and
+// queue_overwritePushMany() calls to a queue and to an array that holds the
+// expected contents, oldest first, and compares the two after every call.
+// Then checks the error conditions and queue_fill().
+static bool queue_bulkTest(void) {
+  bool testResult = true;
+  double expected[BULK_TEST_QUEUE_SIZE];
+  double values[BULK_TEST_MAX_COUNT];
+  queue_size_t expectedCount = 0;
+  queue_t testQ;
+  initTestQueue(&testQ, BULK_TEST_QUEUE_SIZE, BULK_TEST_QUEUE_NAME);
+  for (uint16_t i = 0; i < BULK_TEST_ITERATION_COUNT && testResult; i++) {
+    queue_size_t count;
+    switch (rand() % 3) {
+    case 0: // Push as much as fits, up to a random count.
+      count = rand() % (BULK_TEST_QUEUE_SIZE - expectedCount + 1);
+      for (queue_index_t j = 0; j < count; j++)
+        expected[expectedCount++] = values[j] = (double)rand();
+      queue_pushMany(&testQ, values, count);
+      testResult = queue_matchesArray(&testQ, expected, expectedCount,
+                                      "queue_pushMany()");
+      break;
+    case 1: // Pop up to everything.
+      count = rand() % (expectedCount + 1);
+      queue_popMany(&testQ, values, count);
+      for (queue_index_t j = 0; j < count && testResult; j++) {
+        if (values[j] != expected[j]) {
+          printf("* Error: queue_popMany(%s) returned the wrong values.\n",
+                 queue_name(&testQ));
+          testResult = false;
+        }
+      }
+      expectedCount -= count;
+      for (queue_index_t j = 0; j < expectedCount; j++)
+        expected[j] = expected[j + count];
+      testResult = testResult && queue_matchesArray(&testQ, expected,
+                                                    expectedCount,
+                                                    "queue_popMany()");
+      break;
+    default: // Overwrite up to twice the capacity.
+      count = rand() % (BULK_TEST_MAX_COUNT + 1);
+      for (queue_index_t j = 0; j < count; j++) {
+        values[j] = (double)rand();
+        if (expectedCount == BULK_TEST_QUEUE_SIZE) {
+          for (queue_index_t k = 0; k < expectedCount - 1; k++)
+            expected[k] = expected[k + 1];
+          expectedCount--;
+        }
+        expected[expectedCount++] = values[j];
+      }
+      queue_overwritePushMany(&testQ, values, count);
+      testResult = queue_matchesArray(&testQ, expected, expectedCount,
+                                      "queue_overwritePushMany()");
+      break;
+    }
+  }
+  // Too many values for either direction: nothing changes, flags are set.
+  printf("=== + User code should print a queue full and a queue empty error "
+         "message-> ");
+  queue_fill(&testQ, 1.0);
+  queue_pushMany(&testQ, values, 1);
+  queue_popMany(&testQ, values, BULK_TEST_QUEUE_SIZE + 1);
+  if (!queue_overflow(&testQ) || !queue_underflow(&testQ)) {
+    printf("* Error: queue_pushMany() or queue_popMany() did not set the "
+           "overflow or underflow flag.\n");
+    testResult = false;
+  }
+  for (queue_index_t j = 0; j < BULK_TEST_QUEUE_SIZE; j++)
+    expected[j] = 1.0;
+  testResult = queue_matchesArray(&testQ, expected, BULK_TEST_QUEUE_SIZE,
+                                  "queue_fill()") &&
+               testResult;
+  queue_garbageCollect(&testQ);
+  return testResult;
+}
+
 #define QUEUE_TEST_MAX_QUEUE_SIZE 100 // Used for the fill/empty tests.
 #define QUEUE_TEST_MAX_LOOP_COUNT                                              \
   10 // All tests will be invoked this many times.
@@ -544,7 +672,8 @@ bool queue_overwritePushTest(void) {
 // 5. Refill the array with the previous random values.
 // 6. Use queue_overwritePush() to write over all of the elements of the array,
 // checking the contents.
-bool queue_runTest(void) {
+// Runs on the kind of queue selected by testQueueKind.
+static bool queue_runModeTest(void) {
   bool testResult = true; // Be optimistic.
   // Overall test will be executed QUEUE_TEST_MAX_LOOP_COUNT times.
   for (uint32_t loopCount = 0; loopCount < QUEUE_TEST_MAX_LOOP_COUNT;
@@ -563,7 +692,7 @@ bool queue_runTest(void) {
       dataArray[i] = (double)rand();
     }
     queue_t testQ; // queue instance used for testing.
-    queue_init(&testQ, arraySize, QUEUE_TEST_QUEUE_NAME); // Init the queue.
+    initTestQueue(&testQ, arraySize, QUEUE_TEST_QUEUE_NAME); // Init the queue.
     testResult =
         queue_fillTest(&testQ, dataArray, arraySize) ? testResult : false;
     if (testResult) {
@@ -628,6 +757,17 @@ bool queue_runTest(void) {
     } else {
       printf("=== Queue: %s failed overwritePush test.\n", queue_name(&testQ));
     }
+    testResult = tempResult
+                     ? testResult
+                     : false; // Logical AND of testResult and tempResult.
+    printf("=== Commencing bulk test (queue_pushMany(), queue_popMany(), "
+           "queue_overwritePushMany(), queue_fill()) === \n");
+    tempResult = queue_bulkTest();
+    if (tempResult) {
+      printf("=== Queue: %s passed bulk test.\n", queue_name(&testQ));
+    } else {
+      printf("=== Queue: %s failed bulk test.\n", queue_name(&testQ));
+    }
     testResult = tempResult
                      ? testResult
                      : false; // Logical AND of testResult and tempResult.
@@ -643,3 +783,478 @@ bool queue_runTest(void) {
   }
   return testResult;
 }
+
+#define FAST_TEST_QUEUE_SIZE 100 // Rounded up to 128 slots.
+#define FAST_TEST_PUSH_COUNT 300 // Wraps the 128 slots twice.
+#define FAST_TEST_QUEUE_NAME "fastQ"
+// Checks queue_overwritePushFast(), queue_readElementAtFast() and
+// queue_popFast() against an array, across several wraps of the data array.
+static bool queue_fastAccessorTest(void) {
+  bool testResult = true;
+  double dataArray[FAST_TEST_PUSH_COUNT];
+  queue_t testQ;
+  queue_initPowerOfTwo(&testQ, FAST_TEST_QUEUE_SIZE, FAST_TEST_QUEUE_NAME);
+  for (uint16_t i = 0; i < FAST_TEST_PUSH_COUNT; i++) {
+    dataArray[i] = (double)rand();
+    queue_overwritePushFast(&testQ, dataArray[i]);
+  }
+  // The newest FAST_TEST_QUEUE_SIZE values remain, oldest first.
+  uint16_t oldest = FAST_TEST_PUSH_COUNT - FAST_TEST_QUEUE_SIZE;
+  if (queue_elementCount(&testQ) != FAST_TEST_QUEUE_SIZE) {
+    printf("* Error: %s holds %u elements, should hold %u.\n",
+           queue_name(&testQ), queue_elementCount(&testQ),
+           FAST_TEST_QUEUE_SIZE);
+    testResult = false;
+  }
+  for (uint16_t i = 0; i < FAST_TEST_QUEUE_SIZE; i++) {
+    if (queue_readElementAtFast(&testQ, i) != dataArray[oldest + i] ||
+        queue_readElementAt(&testQ, i) != dataArray[oldest + i]) {
+      printf("* Error: %s[%u] is incorrect after queue_overwritePushFast().\n",
+             queue_name(&testQ), i);
+      testResult = false;
+      break;
+    }
+  }
+  for (uint16_t i = 0; i < FAST_TEST_QUEUE_SIZE; i++) {
+    if (queue_popFast(&testQ) != dataArray[oldest + i]) {
+      printf("* Error: queue_popFast(%s) returned the wrong value.\n",
+             queue_name(&testQ));
+      testResult = false;
+      break;
+    }
+  }
+  if (!queue_empty(&testQ)) {
+    printf("* Error: %s is not empty after popping every value.\n",
+           queue_name(&testQ));
+    testResult = false;
+  }
+  queue_garbageCollect(&testQ);
+  return testResult;
+}
+
+#define BENCHMARK_TIMER INTERVAL_TIMER_TIMER_1
+#define BENCHMARK_QUEUE_SIZE 81 // As many taps as the FIR filter.
+#define BENCHMARK_ITERATION_COUNT 20000 // Two seconds worth of FIR outputs.
+#define BENCHMARK_QUEUE_NAME "benchmarkQ"
+// Runs the FIR filter's access pattern (one push, then a read of every
+// element) on q and returns the run time in seconds. Adds the values read to
+// *sum so that the reads cannot be optimized away.
+static double queue_benchmarkChecked(queue_t *q, double *sum) {
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < BENCHMARK_ITERATION_COUNT; i++) {
+    queue_overwritePush(q, (double)i);
+    for (queue_index_t j = 0; j < BENCHMARK_QUEUE_SIZE; j++)
+      *sum += queue_readElementAt(q, j);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Same as queue_benchmarkChecked() with the inline accessors.
+static double queue_benchmarkFast(queue_t *q, double *sum) {
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < BENCHMARK_ITERATION_COUNT; i++) {
+    queue_overwritePushFast(q, (double)i);
+    for (queue_index_t j = 0; j < BENCHMARK_QUEUE_SIZE; j++)
+      *sum += queue_readElementAtFast(q, j);
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Same as queue_benchmarkChecked() with queue_window() on a mirrored queue.
+static double queue_benchmarkWindow(queue_t *q, double *sum) {
+  intervalTimer_reset(BENCHMARK_TIMER);
+  intervalTimer_start(BENCHMARK_TIMER);
+  for (uint32_t i = 0; i < BENCHMARK_ITERATION_COUNT; i++) {
+    const queue_data_t *span;
+    queue_overwritePushFast(q, (double)i);
+    queue_window(q, BENCHMARK_QUEUE_SIZE, &span);
+    for (queue_index_t j = 0; j < BENCHMARK_QUEUE_SIZE; j++)
+      *sum += span[j];
+  }
+  intervalTimer_stop(BENCHMARK_TIMER);
+  return intervalTimer_getTotalDurationInSeconds(BENCHMARK_TIMER);
+}
+
+// Prints the time per access of the modulo-indexed queue, the mask-indexed
+// queue, the inline accessors and queue_window(). Returns false if they read
+// different values.
+static bool queue_runBenchmark(void) {
+  queue_t moduloQ, maskQ, fastQ, windowQ;
+  queue_init(&moduloQ, BENCHMARK_QUEUE_SIZE, BENCHMARK_QUEUE_NAME);
+  queue_initPowerOfTwo(&maskQ, BENCHMARK_QUEUE_SIZE, BENCHMARK_QUEUE_NAME);
+  queue_initPowerOfTwo(&fastQ, BENCHMARK_QUEUE_SIZE, BENCHMARK_QUEUE_NAME);
+  queue_initMirrored(&windowQ, BENCHMARK_QUEUE_SIZE, BENCHMARK_QUEUE_NAME);
+  for (uint16_t i = 0; i < BENCHMARK_QUEUE_SIZE; i++) {
+    queue_overwritePush(&moduloQ, 0.0);
+    queue_overwritePush(&maskQ, 0.0);
+    queue_overwritePush(&fastQ, 0.0);
+    queue_overwritePush(&windowQ, 0.0);
+  }
+  intervalTimer_init(BENCHMARK_TIMER);
+  double moduloSum = 0.0, maskSum = 0.0, fastSum = 0.0, windowSum = 0.0;
+  double moduloSeconds = queue_benchmarkChecked(&moduloQ, &moduloSum);
+  double maskSeconds = queue_benchmarkChecked(&maskQ, &maskSum);
+  double fastSeconds = queue_benchmarkFast(&fastQ, &fastSum);
+  double windowSeconds = queue_benchmarkWindow(&windowQ, &windowSum);
+  queue_garbageCollect(&moduloQ);
+  queue_garbageCollect(&maskQ);
+  queue_garbageCollect(&fastQ);
+  queue_garbageCollect(&windowQ);
+
+  double accessCount =
+      (double)BENCHMARK_ITERATION_COUNT * (BENCHMARK_QUEUE_SIZE + 1);
+  printf("queue benchmark, %u pushes, each followed by %u reads:\n",
+         BENCHMARK_ITERATION_COUNT, BENCHMARK_QUEUE_SIZE);
+  printf("  modulo-indexed: %.2f ns per access\n",
+         moduloSeconds / accessCount * 1e9);
+  printf("  mask-indexed:   %.2f ns per access\n",
+         maskSeconds / accessCount * 1e9);
+#ifdef NDEBUG
+  printf("  inline:         %.2f ns per access (%.1fx modulo-indexed)\n",
+         fastSeconds / accessCount * 1e9, moduloSeconds / fastSeconds);
+#else
+  printf("  inline:         %.2f ns per access (checked, NDEBUG not set)\n",
+         fastSeconds / accessCount * 1e9);
+#endif
+  printf("  queue_window:   %.2f ns per access (%.1fx modulo-indexed)\n",
+         windowSeconds / accessCount * 1e9, moduloSeconds / windowSeconds);
+  bool testResult =
+      moduloSum == maskSum && maskSum == fastSum && fastSum == windowSum;
+  if (!testResult)
+    printf("* Error: the benchmark runs read different values.\n");
+  return testResult;
+}
+
+#define WINDOW_TEST_QUEUE_SIZE 100 // Two copies of 128 slots.
+#define WINDOW_TEST_PUSH_COUNT 1000
+#define WINDOW_TEST_QUEUE_NAME "windowQ"
+// Checks queue_window() against queue_readElementAt() for every window
+// length after every push, and checks that it rejects windows longer than
+// the queue contents and queues that are not mirrored.
+static bool queue_windowTest(void) {
+  bool testResult = true;
+  queue_t testQ;
+  const queue_data_t *span;
+  queue_initMirrored(&testQ, WINDOW_TEST_QUEUE_SIZE, WINDOW_TEST_QUEUE_NAME);
+  for (uint16_t i = 0; i < WINDOW_TEST_PUSH_COUNT && testResult; i++) {
+    if (i % 2)
+      queue_overwritePush(&testQ, (double)rand());
+    else
+      queue_overwritePushFast(&testQ, (double)rand());
+    queue_size_t count = queue_elementCount(&testQ);
+    for (queue_size_t n = 1; n <= count && testResult; n++) {
+      if (!queue_window(&testQ, n, &span)) {
+        printf("* Error: queue_window(%s, %u) failed.\n", queue_name(&testQ),
+               n);
+        testResult = false;
+        break;
+      }
+      for (queue_size_t j = 0; j < n; j++) {
+        if (span[j] != queue_readElementAt(&testQ, count - n + j)) {
+          printf("* Error: queue_window(%s, %u)[%u] is incorrect after %u "
+                 "pushes.\n",
+                 queue_name(&testQ), n, j, i + 1);
+          testResult = false;
+          break;
+        }
+      }
+    }
+  }
+  printf("=== + User code should print two queue_window() error messages-> ");
+  if (queue_window(&testQ, WINDOW_TEST_QUEUE_SIZE + 1, &span)) {
+    printf("* Error: queue_window(%s) returned more elements than it holds.\n",
+           queue_name(&testQ));
+    testResult = false;
+  }
+  queue_garbageCollect(&testQ);
+  queue_initPowerOfTwo(&testQ, WINDOW_TEST_QUEUE_SIZE, WINDOW_TEST_QUEUE_NAME);
+  queue_push(&testQ, 0.0);
+  if (queue_window(&testQ, 1, &span)) {
+    printf("* Error: queue_window(%s) accepted a queue that is not "
+           "mirrored.\n",
+           queue_name(&testQ));
+    testResult = false;
+  }
+  queue_garbageCollect(&testQ);
+  return testResult;
+}
+
+#define STORAGE_TEST_QUEUE_SIZE 100
+#define STORAGE_TEST_GUARD_LENGTH 8 // Sentinel slots after the storage.
+#define STORAGE_TEST_SENTINEL -12345.0
+#define STORAGE_TEST_PUSH_COUNT 1000
+#define STORAGE_TEST_QUEUE_NAME "storageQ"
+// Checks that the QUEUE_*_STORAGE_LENGTH() macros agree with
+// queue_storageLength(), then runs queues of every layout on static storage
+// with sentinels after it: the contents must match a queue_init*() queue fed
+// the same values, and no push may write past the storage.
+static bool queue_storageTest(void) {
+  bool testResult = true;
+  const queue_size_t sizes[] = {1, 2, 3, 100, 2000, 2048, 2049};
+  for (uint16_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    queue_size_t size = sizes[i];
+    if (QUEUE_MODULO_STORAGE_LENGTH(size) !=
+            queue_storageLength(size, QUEUE_LAYOUT_MODULO) ||
+        QUEUE_POWER_OF_TWO_STORAGE_LENGTH(size) !=
+            queue_storageLength(size, QUEUE_LAYOUT_POWER_OF_TWO) ||
+        QUEUE_MIRRORED_STORAGE_LENGTH(size) !=
+            queue_storageLength(size, QUEUE_LAYOUT_MIRRORED)) {
+      printf("* Error: the storage length macros disagree with "
+             "queue_storageLength(%u).\n",
+             size);
+      testResult = false;
+    }
+  }
+  static queue_data_t storage[QUEUE_MIRRORED_STORAGE_LENGTH(
+                                  STORAGE_TEST_QUEUE_SIZE) +
+                              STORAGE_TEST_GUARD_LENGTH];
+  const queue_layout_t layouts[] = {QUEUE_LAYOUT_MODULO,
+                                    QUEUE_LAYOUT_POWER_OF_TWO,
+                                    QUEUE_LAYOUT_MIRRORED};
+  for (uint16_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); i++) {
+    queue_size_t length =
+        queue_storageLength(STORAGE_TEST_QUEUE_SIZE, layouts[i]);
+    for (queue_index_t j = 0; j < length + STORAGE_TEST_GUARD_LENGTH; j++)
+      storage[j] = STORAGE_TEST_SENTINEL;
+    queue_t staticQ, heapQ;
+    queue_initInStorage(&staticQ, STORAGE_TEST_QUEUE_SIZE, layouts[i], storage,
+                        STORAGE_TEST_QUEUE_NAME);
+    queue_init(&heapQ, STORAGE_TEST_QUEUE_SIZE, STORAGE_TEST_QUEUE_NAME);
+    for (uint16_t j = 0; j < STORAGE_TEST_PUSH_COUNT; j++) {
+      double value = (double)rand();
+      queue_overwritePush(&staticQ, value);
+      queue_overwritePush(&heapQ, value);
+    }
+    for (queue_index_t j = 0; j < STORAGE_TEST_QUEUE_SIZE; j++) {
+      if (queue_readElementAt(&staticQ, j) != queue_readElementAt(&heapQ, j)) {
+        printf("* Error: %s[%u] in static storage (layout %d) is "
+               "incorrect.\n",
+               queue_name(&staticQ), j, layouts[i]);
+        testResult = false;
+        break;
+      }
+    }
+    for (queue_index_t j = length; j < length + STORAGE_TEST_GUARD_LENGTH;
+         j++) {
+      if (storage[j] != STORAGE_TEST_SENTINEL) {
+        printf("* Error: %s (layout %d) wrote past its storage.\n",
+               queue_name(&staticQ), layouts[i]);
+        testResult = false;
+        break;
+      }
+    }
+    queue_garbageCollect(&staticQ); // Must not free the static array.
+    queue_garbageCollect(&heapQ);
+  }
+  return testResult;
+}
+
+#define DEBUG_TABLE_TEST_QUEUE_SIZE 4
+#define DEBUG_TABLE_TEST_NAME_A "debugQA"
+#define DEBUG_TABLE_TEST_NAME_B "debugQB"
+#define DEBUG_TABLE_TEST_NAME_C "debugQC"
+#define DEBUG_TABLE_TEST_REUSE_NAME "reuseQ"
+#define DEBUG_TABLE_TEST_OVERFLOW_NAME "overflowQ"
+
+// Tests the debug side table and the flags: names and flags belong to their
+// own queue, re-initializing a queue keeps its entry,
+// queue_garbageCollect() hands the entry back for the next queue, and a queue
+// past a full table is untracked but works.
+static bool queue_debugTableTest(void) {
+  bool testResult = true;
+  printf("sizeof(queue_t): %u bytes (%d-byte cache lines)\n",
+         (unsigned)sizeof(queue_t), QUEUE_CACHE_LINE_SIZE);
+  static queue_data_t storageA[DEBUG_TABLE_TEST_QUEUE_SIZE];
+  static queue_data_t storageB[DEBUG_TABLE_TEST_QUEUE_SIZE];
+  queue_t qA, qB;
+  queue_initInStorage(&qA, DEBUG_TABLE_TEST_QUEUE_SIZE, QUEUE_LAYOUT_MODULO,
+                      storageA, DEBUG_TABLE_TEST_NAME_A);
+  queue_initInStorage(&qB, DEBUG_TABLE_TEST_QUEUE_SIZE, QUEUE_LAYOUT_MODULO,
+                      storageB, DEBUG_TABLE_TEST_NAME_B);
+  printf("The next message should be an error message.\n");
+  queue_pop(&qA);
+  if (!queue_underflow(&qA) || queue_underflow(&qB)) {
+    printf("* Error: the underflow flag of %s leaked into %s.\n",
+           queue_name(&qA), queue_name(&qB));
+    testResult = false;
+  }
+  if (strcmp(queue_name(&qA), DEBUG_TABLE_TEST_NAME_A) ||
+      strcmp(queue_name(&qB), DEBUG_TABLE_TEST_NAME_B)) {
+    printf("* Error: queue names are %s and %s, should be %s and %s.\n",
+           queue_name(&qA), queue_name(&qB), DEBUG_TABLE_TEST_NAME_A,
+           DEBUG_TABLE_TEST_NAME_B);
+    testResult = false;
+  }
+  queue_initInStorage(&qA, DEBUG_TABLE_TEST_QUEUE_SIZE, QUEUE_LAYOUT_MODULO,
+                      storageA, DEBUG_TABLE_TEST_NAME_C);
+  if (queue_underflow(&qA) || strcmp(queue_name(&qA), DEBUG_TABLE_TEST_NAME_C) ||
+      strcmp(queue_name(&qB), DEBUG_TABLE_TEST_NAME_B)) {
+    printf("* Error: re-initializing %s did not reset only its own entry.\n",
+           queue_name(&qA));
+    testResult = false;
+  }
+  queue_garbageCollect(&qA);
+  queue_garbageCollect(&qB);
+  if (strcmp(queue_name(&qA), QUEUE_UNTRACKED_NAME)) {
+    printf("* Error: %s kept its entry after queue_garbageCollect().\n",
+           queue_name(&qA));
+    testResult = false;
+  }
+  // More queues than there are entries, one at a time: each one must get the
+  // entry of the one before, or the table fills up and aborts.
+  static queue_data_t reuseStorage[DEBUG_TABLE_TEST_QUEUE_SIZE];
+  for (uint16_t i = 0; i < QUEUE_DEBUG_TABLE_SIZE + 1; i++) {
+    queue_t reuseQ;
+    queue_initInStorage(&reuseQ, DEBUG_TABLE_TEST_QUEUE_SIZE,
+                        QUEUE_LAYOUT_MODULO, reuseStorage,
+                        DEBUG_TABLE_TEST_REUSE_NAME);
+    if (strcmp(queue_name(&reuseQ), DEBUG_TABLE_TEST_REUSE_NAME)) {
+      printf("* Error: queue %u is named %s, should be %s.\n", i,
+             queue_name(&reuseQ), DEBUG_TABLE_TEST_REUSE_NAME);
+      testResult = false;
+    }
+    queue_garbageCollect(&reuseQ);
+  }
+  // One more queue than there are entries at once: the ones past a full table
+  // report QUEUE_UNTRACKED_NAME but still work.
+  static queue_t overflowQ[QUEUE_DEBUG_TABLE_SIZE + 1];
+  static queue_data_t overflowStorage[DEBUG_TABLE_TEST_QUEUE_SIZE];
+  printf("The next messages should be debug table warnings.\n");
+  for (uint16_t i = 0; i < QUEUE_DEBUG_TABLE_SIZE + 1; i++)
+    queue_initInStorage(&overflowQ[i], DEBUG_TABLE_TEST_QUEUE_SIZE,
+                        QUEUE_LAYOUT_MODULO, overflowStorage,
+                        DEBUG_TABLE_TEST_OVERFLOW_NAME);
+  queue_t *lastQ = &overflowQ[QUEUE_DEBUG_TABLE_SIZE];
+  queue_overwritePush(lastQ, 1.0);
+  queue_overwritePush(lastQ, 2.0);
+  if (strcmp(queue_name(lastQ), QUEUE_UNTRACKED_NAME) ||
+      queue_elementCount(lastQ) != 2 || queue_pop(lastQ) != 1.0 ||
+      queue_pop(lastQ) != 2.0) {
+    printf("* Error: %s past a full debug table should be untracked and "
+           "work.\n",
+           queue_name(lastQ));
+    testResult = false;
+  }
+  for (uint16_t i = 0; i < QUEUE_DEBUG_TABLE_SIZE + 1; i++)
+    queue_garbageCollect(&overflowQ[i]);
+  return testResult;
+}
+
+#define TYPED_TEST_QUEUE_SIZE 100
+#define TYPED_TEST_PUSH_COUNT 1000
+#define TYPED_TEST_POP_COUNT 10
+#define TYPED_TEST_QUEUE_NAME "typedQ"
+// Small integers that every element type holds exactly.
+#define TYPED_TEST_VALUE(i) ((int16_t)(((i) * 37) % 1000 - 500))
+
+// Defines static bool prefix##_typedTest(void), which feeds a mirrored queue
+// of one element type and a mirrored queue_t the same values through the
+// checked, inline and bulk functions and checks that they hold the same
+// elements, in queue_readElementAt() and queue_window() order.
+#define DEFINE_TYPED_QUEUE_TEST(prefix)                                        \
+  static bool prefix##_typedTest(void) {                                       \
+    bool testResult = true;                                                    \
+    prefix##_t typedQ;                                                         \
+    queue_t referenceQ;                                                        \
+    prefix##_initMirrored(&typedQ, TYPED_TEST_QUEUE_SIZE,                      \
+                          TYPED_TEST_QUEUE_NAME);                              \
+    queue_initMirrored(&referenceQ, TYPED_TEST_QUEUE_SIZE,                     \
+                       TYPED_TEST_QUEUE_NAME);                                 \
+    for (uint16_t i = 0; i < TYPED_TEST_PUSH_COUNT; i++) {                     \
+      if (i % 2)                                                               \
+        prefix##_overwritePush(&typedQ, TYPED_TEST_VALUE(i));                  \
+      else                                                                     \
+        prefix##_overwritePushFast(&typedQ, TYPED_TEST_VALUE(i));              \
+      queue_overwritePush(&referenceQ, TYPED_TEST_VALUE(i));                   \
+    }                                                                          \
+    prefix##_data_t popped[TYPED_TEST_POP_COUNT];                              \
+    queue_data_t referencePopped[TYPED_TEST_POP_COUNT];                        \
+    prefix##_popMany(&typedQ, popped, TYPED_TEST_POP_COUNT);                   \
+    queue_popMany(&referenceQ, referencePopped, TYPED_TEST_POP_COUNT);         \
+    prefix##_pushMany(&typedQ, popped, TYPED_TEST_POP_COUNT);                  \
+    queue_pushMany(&referenceQ, referencePopped, TYPED_TEST_POP_COUNT);        \
+    const prefix##_data_t *span;                                               \
+    queue_size_t count = prefix##_elementCount(&typedQ);                       \
+    if (count != queue_elementCount(&referenceQ) ||                            \
+        !prefix##_window(&typedQ, count, &span)) {                             \
+      printf("* Error: " #prefix "_t %s holds %u elements, should be %u.\n",   \
+             prefix##_name(&typedQ), count,                                    \
+             queue_elementCount(&referenceQ));                                 \
+      testResult = false;                                                      \
+    }                                                                          \
+    for (queue_index_t i = 0; i < count && testResult; i++) {                  \
+      queue_data_t expected = queue_readElementAt(&referenceQ, i);             \
+      if (prefix##_readElementAt(&typedQ, i) != expected ||                    \
+          prefix##_readElementAtFast(&typedQ, i) != expected ||                \
+          span[i] != expected) {                                               \
+        printf("* Error: " #prefix "_t %s[%u] is incorrect.\n",                \
+               prefix##_name(&typedQ), i);                                     \
+        testResult = false;                                                    \
+      }                                                                        \
+    }                                                                          \
+    if (sizeof(prefix##_t) != sizeof(queue_t)) {                               \
+      printf("* Error: the " #prefix "_t header differs from queue_t.\n");     \
+      testResult = false;                                                      \
+    }                                                                          \
+    prefix##_garbageCollect(&typedQ);                                          \
+    queue_garbageCollect(&referenceQ);                                         \
+    return testResult;                                                         \
+  }
+
+DEFINE_TYPED_QUEUE_TEST(queueFloat)
+DEFINE_TYPED_QUEUE_TEST(queueInt32)
+DEFINE_TYPED_QUEUE_TEST(queueInt16)
+
+// Returns true if test passed, false otherwise.
+// Runs all of the tests above on modulo-indexed, power-of-two and mirrored
+// queues, then tests the inline accessors, queue_window(), caller-supplied
+// storage, the debug side table and the queues of the other element types and
+// prints a benchmark of the accessors.
+bool queue_runTest(void) {
+  testQueueKind = QUEUE_TEST_MODULO;
+  printf("=== Testing modulo-indexed queues (queue_init()) ===\n");
+  bool testResult = queue_runModeTest();
+  testQueueKind = QUEUE_TEST_POWER_OF_TWO;
+  printf("=== Testing power-of-two queues (queue_initPowerOfTwo()) ===\n");
+  testResult = queue_runModeTest() ? testResult : false;
+  testQueueKind = QUEUE_TEST_MIRRORED;
+  printf("=== Testing mirrored queues (queue_initMirrored()) ===\n");
+  testResult = queue_runModeTest() ? testResult : false;
+  if (queue_fastAccessorTest()) {
+    printf("=== Inline queue accessors passed.\n");
+  } else {
+    printf("=== Inline queue accessors failed.\n");
+    testResult = false;
+  }
+  if (queue_windowTest()) {
+    printf("=== queue_window() passed.\n");
+  } else {
+    printf("=== queue_window() failed.\n");
+    testResult = false;
+  }
+  if (queue_storageTest()) {
+    printf("=== queue_initInStorage() passed.\n");
+  } else {
+    printf("=== queue_initInStorage() failed.\n");
+    testResult = false;
+  }
+  if (queue_debugTableTest()) {
+    printf("=== Queue debug side table passed.\n");
+  } else {
+    printf("=== Queue debug side table failed.\n");
+    testResult = false;
+  }
+  if (queueFloat_typedTest() && queueInt32_typedTest() &&
+      queueInt16_typedTest()) {
+    printf("=== float, int32_t and int16_t queues passed.\n");
+  } else {
+    printf("=== float, int32_t and int16_t queues failed.\n");
+    testResult = false;
+  }
+  testResult = queue_runBenchmark() ? testResult : false;
+  return testResult;
+}
@@ -13,6 +13,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdlib.h>
 #include <string.h>
 
+#include "adcCapture.h"
 #include "buffer.h"
 #include "buttons.h"
 #include "detector.h"
@@ -101,6 +102,38 @@ void runningModes_printRunTimeStatistics(void) {
   display_printDecimalInt(remainingElementCount);
   display_print("\n\n");
 
+  // Print out the ADC buffer health counters. The histogram is in eighths of
+  // the capacity, emptiest first; ages are in ISR ticks (10 us).
+  buffer_stats_t bufferStats = buffer_getStats();
+  display_print("ADC buffer overwritten/high-water/max age: ");
+  sprintf(sprintfBuffer, "%lu/%lu/%lu", (unsigned long)bufferStats.overwrittenCount,
+          (unsigned long)bufferStats.highWaterMark,
+          (unsigned long)bufferStats.maxOldestValueAge);
+  display_print(sprintfBuffer);
+  display_print("\nADC buffer occupancy:");
+  for (uint16_t i = 0; i < BUFFER_STATS_HISTOGRAM_BIN_COUNT; i++) {
+    sprintf(sprintfBuffer, " %lu",
+            (unsigned long)bufferStats.occupancyHistogram[i]);
+    display_print(sprintfBuffer);
+  }
+  display_print("\n\n");
+
+#ifdef ISR_BLOCK_CAPTURE
+  // Print out the block latency, from the last sample of a block to the end
+  // of its processing, in ISR ticks (10 us).
+  detector_blockStats_t blockStats = detector_getBlockStats();
+  display_print("Block latency in ticks, mean/max: ");
+  sprintf(sprintfBuffer, "%.1f/%lu",
+          blockStats.blockCount
+              ? (double)blockStats.totalLatencyTicks / blockStats.blockCount
+              : 0.0,
+          (unsigned long)blockStats.maxLatencyTicks);
+  display_print(sprintfBuffer);
+  display_print("\nDropped ADC samples: ");
+  display_printDecimalInt(adcCapture_getDroppedSampleCount());
+  display_print("\n\n");
+#endif
+
   // Print out total running time in seconds.
   double runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
   display_print("Measured run time in seconds: ");
@@ -234,7 +267,11 @@ void runningModes_continuous(void) {
     // Run filters, compute power, etc.
     intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
                                                 // doing something.
+#ifdef ISR_BLOCK_CAPTURE
+    detector_runBlocks(); // The ISR hands over whole blocks.
+#else
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
+#endif
     intervalTimer_stop(MAIN_CUMULATIVE_TIMER);
     // If enough ticks have transpired, update the histogram.
     if (histogramSystemTicks >= SYSTEM_TICKS_PER_HISTOGRAM_UPDATE) {
@@ -296,7 +333,11 @@ void runningModes_shooter(void) {
     intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
                                                 // doing something.
     // Run filters, compute power, run hit-detection.
+#ifdef ISR_BLOCK_CAPTURE
+    detector_runBlocks(); // The ISR hands over whole blocks.
+#else
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
+#endif
     if (detector_hitDetected()) {           // Hit detected
       hitCount++;                           // increment the hit count.
       detector_clearHit();                  // Clear the hit.
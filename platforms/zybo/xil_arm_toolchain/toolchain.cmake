@@ -9,12 +9,12 @@ SET(CMAKE_SHARED_LIBRARY_LINK_CXX_FLAGS)
 SET(CMAKE_SHARED_LIBRARY_LINK_C_FLAGS)
 
 add_compile_options("-march=armv7-a")
-add_compile_options("-mfpu=vfpv3")
+add_compile_options("-mfpu=neon")
 add_compile_options("-mfloat-abi=hard")
 add_compile_options("-O2")
 
 add_link_options("-march=armv7-a")
-add_link_options("-mfpu=vfpv3")
+add_link_options("-mfpu=neon")
 add_link_options("-mfloat-abi=hard")
 add_link_options("-mhard-float")
 add_link_options("-Wl,-build-id=none")
@@ -0,0 +1,188 @@
+#!/usr/bin/python3
+
+"""
+Converts the 10th-order direct-form IIR bandpass filters in lasertag/filter.c
+into cascades of second-order sections (biquads) and prints the result as a C
+initializer.
+
+The poles of each filter are found with Durand-Kerner iteration and then
+polished with Newton's method in 60-digit decimal arithmetic, because the
+pole clusters near the unit circle are too ill-conditioned for plain doubles.
+The numerator of every filter is g * (1 - z^-2)^5, so each section gets a
+(1, 0, -1) numerator. Sections are ordered from least to most resonant and the
+gain g is distributed so that every partial cascade peaks at unity gain, which
+keeps the intermediate signals bounded for fixed-point implementations.
+
+Each section is printed as {b0, b1, b2, a1, a2} with a0 == 1.
+"""
+
+import argparse
+import cmath
+import math
+import pathlib
+import re
+import sys
+from decimal import Decimal, getcontext
+
+repo_path = pathlib.Path(__file__).absolute().parent.parent.resolve()
+
+SECTION_COUNT = 5
+FREQUENCY_GRID_POINTS = 4000
+getcontext().prec = 60
+
+
+class DecimalComplex:
+    """ Minimal complex number on top of Decimal for root polishing """
+
+    # pylint: disable=too-few-public-methods
+
+    def __init__(self, real, imag=0):
+        self.real = Decimal(real)
+        self.imag = Decimal(imag)
+
+    def __add__(self, other):
+        return DecimalComplex(self.real + other.real, self.imag + other.imag)
+
+    def __sub__(self, other):
+        return DecimalComplex(self.real - other.real, self.imag - other.imag)
+
+    def __mul__(self, other):
+        return DecimalComplex(
+            self.real * other.real - self.imag * other.imag,
+            self.real * other.imag + self.imag * other.real,
+        )
+
+    def __truediv__(self, other):
+        denominator = other.real * other.real + other.imag * other.imag
+        return DecimalComplex(
+            (self.real * other.real + self.imag * other.imag) / denominator,
+            (self.imag * other.real - self.real * other.imag) / denominator,
+        )
+
+
+def read_table(source, name):
+    """ Read a two-dimensional double table out of filter.c """
+    block = source[source.index(name + "[FILTER") :]
+    block = block[: block.index("};")]
+    rows = re.findall(r"\{([^{}]*)\}", block)
+    return [[float(value) for value in row.split(",")] for row in rows]
+
+
+def durand_kerner(coefficients, iterations=2000):
+    """ Approximate all roots of a monic polynomial (highest power first) """
+    order = len(coefficients) - 1
+    roots = [(0.4 + 0.9j) ** k for k in range(order)]
+    for _ in range(iterations):
+        updated = []
+        for i, root in enumerate(roots):
+            value = 0
+            for coefficient in coefficients:
+                value = value * root + coefficient
+            denominator = 1
+            for j, other in enumerate(roots):
+                if j != i:
+                    denominator *= root - other
+            updated.append(root - value / denominator)
+        roots = updated
+    return roots
+
+
+def newton_polish(coefficients, root, iterations=60):
+    """ Refine a single root with Newton's method in high precision """
+    poly = [DecimalComplex(repr(c)) for c in coefficients]
+    z = DecimalComplex(repr(root.real), repr(root.imag))
+    for _ in range(iterations):
+        value = DecimalComplex(0)
+        derivative = DecimalComplex(0)
+        for coefficient in poly:
+            derivative = derivative * z + value
+            value = value * z + coefficient
+        z = z - value / derivative
+    return complex(float(z.real), float(z.imag))
+
+
+def magnitude_response(sections, omega):
+    """ |H(e^jw)| of a cascade of {b0, b1, b2, a1, a2} sections """
+    z = cmath.exp(-1j * omega)
+    response = 1
+    for b0, b1, b2, a1, a2 in sections:
+        response *= (b0 + b1 * z + b2 * z * z) / (1 + a1 * z + a2 * z * z)
+    return abs(response)
+
+
+def peak_gain(sections):
+    """ Peak magnitude response over [0, pi] """
+    return max(
+        magnitude_response(sections, math.pi * k / FREQUENCY_GRID_POINTS)
+        for k in range(FREQUENCY_GRID_POINTS + 1)
+    )
+
+
+def to_sections(a_coefficients, b_coefficients):
+    """ Convert one direct-form filter into scaled second-order sections """
+    monic = [1.0] + a_coefficients
+    poles = [newton_polish(monic, p) for p in durand_kerner(monic)]
+    upper = sorted((p for p in poles if p.imag > 0), key=abs)
+    if len(upper) != SECTION_COUNT:
+        sys.exit("expected %d complex-conjugate pole pairs" % SECTION_COUNT)
+    gain = b_coefficients[0]
+    sections = []
+    applied_gain = 1.0
+    for index, pole in enumerate(upper):
+        section = [1.0, 0.0, -1.0, -2.0 * pole.real, abs(pole) ** 2]
+        if index < SECTION_COUNT - 1:
+            scale = 1.0 / peak_gain(sections + [section])
+        else:
+            scale = gain / applied_gain
+        applied_gain *= scale
+        section[0] *= scale
+        section[2] *= scale
+        sections.append(section)
+    return sections
+
+
+def format_value(value, fmt, fraction_bits):
+    """ Format one coefficient for the requested C type """
+    if fmt == "q":
+        return "%d" % int(round(value * (1 << fraction_bits)))
+    if fmt == "float":
+        return "%.9ef" % value
+    return "%.17e" % value
+
+
+def main():
+    """ Parse arguments and print the section tables """
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument(
+        "--format", choices=["double", "float", "q"], default="double"
+    )
+    parser.add_argument(
+        "--fraction-bits",
+        type=int,
+        default=29,
+        help="fraction bits when --format=q (default: 29)",
+    )
+    parser.add_argument(
+        "--filter-source", default=str(repo_path / "lasertag" / "filter.c")
+    )
+    args = parser.parse_args()
+
+    source = pathlib.Path(args.filter_source).read_text()
+    a_table = read_table(source, "iirACoefficientConstants")
+    b_table = read_table(source, "iirBCoefficientConstants")
+
+    print("{")
+    for a_coefficients, b_coefficients in zip(a_table, b_table):
+        sections = to_sections(a_coefficients, b_coefficients)
+        print("{")
+        for section in sections:
+            values = [
+                format_value(v, args.format, args.fraction_bits) for v in section
+            ]
+            print("  {" + ", ".join(values) + "},")
+        print("},")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()